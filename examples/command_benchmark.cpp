@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <wdlite/wdlite.hpp>
+
+namespace asio = CURLIO_ASIO_NS;
+
+static std::atomic<std::size_t> allocations{ 0 };
+
+void* operator new(std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (const auto pointer = std::malloc(size == 0 ? 1 : size)) {
+		return pointer;
+	}
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+
+void operator delete(void* pointer, std::size_t /* size */) noexcept { std::free(pointer); }
+
+struct Measurement {
+	std::size_t allocations = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	Measurement() : allocations{ ::allocations.load() } {}
+	void print(std::string_view name, int iterations) const
+	{
+		const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << name << ": " << static_cast<double>(::allocations.load() - allocations) / iterations
+		          << " allocations and " << elapsed.count() / iterations << " us per command\n";
+	}
+};
+
+/// Sends the commands one after another from plain completion handlers and closes the session afterwards.
+inline void run_callbacks(std::shared_ptr<wdlite::Session> session, int remaining, int iterations,
+                          std::shared_ptr<const Measurement> measurement)
+{
+	if (remaining == 0) {
+		measurement->print("callbacks          ", iterations);
+		session->async_close([session](std::error_code /* ec */) {});
+		return;
+	}
+	session->async_get_title(
+	  [session, remaining, iterations, measurement](std::error_code ec, std::string /* title */) mutable {
+		  if (ec) {
+			  std::cerr << "Failed: " << ec.message() << "\n";
+			  return;
+		  }
+		  run_callbacks(std::move(session), remaining - 1, iterations, std::move(measurement));
+	  });
+}
+
+constexpr std::string_view page = "data:text/html,<title>benchmark</title>";
+
+inline nlohmann::json make_capabilities()
+{
+	return wdlite::capabilities::make(wdlite::capabilities::Capabilities{
+	  .browser_specific =
+	    wdlite::capabilities::ChromeOptions{
+	      .arguments = { "--headless=new" },
+	    },
+	});
+}
+
+/// Records the commands of the benchmark so that they can be replayed without any latency or driver.
+inline std::shared_ptr<wdlite::Endpoint> make_replaying_endpoint()
+{
+	const auto path = (std::filesystem::temp_directory_path() / "wdlite-command-benchmark.tape").string();
+	std::remove(path.c_str());
+	{
+		// As long as the IDs of chromedriver.
+		const std::string session_id = "0123456789abcdef0123456789abcdef";
+		const auto capabilities = nlohmann::json{ { "capabilities", make_capabilities() } }.dump();
+		const auto prefix = "session/" + session_id;
+		wdlite::Recorder recorder{ path };
+		recorder.record("POST", "session", capabilities, R"({"value":{"sessionId":")" + session_id + R"("}})");
+		recorder.record("POST", prefix + "/url", nlohmann::json{ { "url", page } }.dump(), R"({"value":null})");
+		recorder.record("GET", prefix + "/title", {}, R"({"value":"benchmark"})");
+		recorder.record("DELETE", prefix, {}, R"({"value":null})");
+	}
+	auto endpoint = std::make_shared<wdlite::Endpoint>("http://replay");
+	endpoint->set_replayer(std::make_shared<wdlite::Replayer>(path, 0));
+	return endpoint;
+}
+
+inline asio::awaitable<void> run(std::shared_ptr<wdlite::Endpoint> endpoint, int iterations)
+{
+	const auto session = co_await wdlite::async_new_session(
+	  co_await asio::this_coro::executor, std::move(endpoint), make_capabilities(), asio::use_awaitable);
+	co_await session->async_navigate(page, asio::use_awaitable);
+
+	// Warm up the connection and the recycled ASIO memory.
+	for (int i = 0; i < 10; ++i) {
+		co_await session->async_get_title(asio::use_awaitable);
+	}
+
+	const Measurement measurement{};
+	for (int i = 0; i < iterations; ++i) {
+		co_await session->async_get_title(asio::use_awaitable);
+	}
+	measurement.print("asio::use_awaitable", iterations);
+
+	run_callbacks(session, iterations, iterations, std::make_shared<Measurement>());
+}
+
+int main(int argc, char** argv)
+{
+	if (argc <= 1) {
+		std::cerr << "Usage: " << argv[0] << " <webdriver-url|--replay> [iterations]\n"
+		          << "With --replay the commands are answered from a tape without any latency to measure only\n"
+		          << "the overhead of wdlite.\n";
+		return 1;
+	}
+	const int iterations = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 500;
+	auto endpoint = std::string_view{ argv[1] } == "--replay" ? make_replaying_endpoint()
+	                                                          : std::make_shared<wdlite::Endpoint>(argv[1]);
+
+	asio::io_service service{};
+	asio::co_spawn(service, run(std::move(endpoint), iterations), asio::detached);
+	service.run();
+	return 0;
+}
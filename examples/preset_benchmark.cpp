@@ -0,0 +1,156 @@
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include <wdlite/wdlite.hpp>
+
+namespace asio = CURLIO_ASIO_NS;
+
+/// Sums the resident memory of every process which was started with `user_data_dir` or is a descendant of
+/// one in MiB. Shared pages are counted multiple times. Only works if the browser runs on this host.
+inline double get_browser_rss(const std::string& user_data_dir)
+{
+	const auto read = [](const std::filesystem::path& path) {
+		std::ifstream file{ path, std::ios::binary };
+		return std::string{ std::istreambuf_iterator<char>{ file }, {} };
+	};
+
+	std::map<int, int> parents;
+	std::map<int, bool> browser;
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator{ "/proc", ec }) {
+		const int pid = std::atoi(entry.path().filename().c_str());
+		if (pid <= 0) {
+			continue;
+		}
+		// The name in the second field may contain spaces.
+		const auto stat = read(entry.path() / "stat");
+		if (const auto end = stat.rfind(')'); end != std::string::npos && end + 4 < stat.size()) {
+			parents[pid] = std::atoi(stat.c_str() + end + 4);
+		}
+		const auto cmdline = read(entry.path() / "cmdline");
+		browser[pid] = cmdline.find("--user-data-dir=" + user_data_dir) != std::string::npos;
+	}
+
+	double rss = 0;
+	for (const auto& [pid, parent] : parents) {
+		// The renderers are started by the browser process.
+		int current = browser[pid] ? pid : parent;
+		while (current > 1 && !browser[current]) {
+			current = parents.count(current) != 0 ? parents[current] : 0;
+		}
+		if (current <= 1) {
+			continue;
+		}
+		const auto status = read("/proc/" + std::to_string(pid) + "/status");
+		if (const auto position = status.find("VmRSS:"); position != std::string::npos) {
+			rss += std::atof(status.c_str() + position + 6) / 1024;
+		}
+	}
+	return rss;
+}
+
+struct Result {
+	std::chrono::steady_clock::duration load{};
+	std::chrono::steady_clock::duration total{};
+	double rss = 0;
+	double js_heap = 0;
+};
+
+inline asio::awaitable<Result> run_preset(const std::string& endpoint, const std::vector<std::string>& urls,
+                                          const wdlite::capabilities::ChromePreset& preset, int rounds)
+{
+	// A unique profile to find the processes of the browser.
+	static int counter = 0;
+	const auto name = "wdlite-preset-" + std::to_string(::getpid()) + "-" + std::to_string(counter++);
+	const auto user_data_dir = (std::filesystem::temp_directory_path() / name).string();
+	auto options = preset.apply(wdlite::capabilities::ChromeOptions{
+	  .arguments = { "--user-data-dir=" + user_data_dir },
+	});
+	const auto session = co_await wdlite::async_new_session(
+	  co_await asio::this_coro::executor, endpoint,
+	  wdlite::capabilities::make(wdlite::capabilities::Capabilities{ .browser_specific = std::move(options) }),
+	  asio::use_awaitable);
+
+	Result result{};
+	for (int round = 0; round < rounds; ++round) {
+		for (const auto& url : urls) {
+			const auto extracted = co_await session->async_navigate_and_extract(
+			  url, "return document.title;", {}, {}, asio::use_awaitable);
+			result.load += extracted.timings.load;
+			result.total += extracted.timings.total;
+		}
+	}
+	result.load /= rounds * urls.size();
+	result.total /= rounds * urls.size();
+	result.rss = get_browser_rss(user_data_dir);
+	try {
+		const auto metrics = co_await session->async_get_browser_metrics(asio::use_awaitable);
+		result.js_heap = metrics.js_heap_used / 1024.0 / 1024.0;
+	} catch (const std::exception& e) {
+		std::cerr << "Failed to get the browser metrics: " << e.what() << "\n";
+	}
+
+	co_await session->async_close(asio::use_awaitable);
+	std::filesystem::remove_all(user_data_dir);
+	co_return result;
+}
+
+inline asio::awaitable<void> run(std::string endpoint, std::vector<std::string> urls)
+{
+	// Every page is loaded this often per preset.
+	constexpr int rounds = 3;
+
+	using wdlite::capabilities::ChromePreset;
+	const std::pair<const char*, ChromePreset> presets[] = {
+		{ "headless", ChromePreset{} },
+		{ "throughput scraping", ChromePreset::throughput_scraping() },
+		{ "low memory", ChromePreset::low_memory() },
+	};
+
+	std::cout << std::left << std::setw(20) << "preset" << std::right << std::setw(12) << "load [ms]"
+	          << std::setw(12) << "total [ms]" << std::setw(12) << "RSS [MiB]" << std::setw(12) << "heap [MiB]"
+	          << "\n"
+	          << std::fixed << std::setprecision(1);
+	for (const auto& [name, preset] : presets) {
+		const auto result = co_await run_preset(endpoint, urls, preset, rounds);
+		std::cout << std::left << std::setw(20) << name << std::right << std::setw(12)
+		          << std::chrono::duration<double, std::milli>{ result.load }.count() << std::setw(12)
+		          << std::chrono::duration<double, std::milli>{ result.total }.count() << std::setw(12)
+		          << result.rss << std::setw(12) << result.js_heap << "\n";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc <= 1) {
+		std::cerr << "Usage: " << argv[0] << " <webdriver-url> [page-url...]\n"
+		          << "The browser has to run on this host to measure its memory.\n";
+		return 1;
+	}
+	std::vector<std::string> urls{ argv + 2, argv + argc };
+	if (urls.empty()) {
+		urls.push_back("https://example.com");
+	}
+	asio::io_service service{};
+	asio::co_spawn(
+	  service,
+	  [&]() -> asio::awaitable<void> {
+		  try {
+			  co_await run(argv[1], std::move(urls));
+		  } catch (const std::exception& e) {
+			  std::cerr << "Benchmark failed: " << e.what() << "\n";
+		  }
+	  },
+	  asio::detached);
+	service.run();
+	return 0;
+}
@@ -0,0 +1,96 @@
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <wdlite/wdlite.hpp>
+
+namespace asio = CURLIO_ASIO_NS;
+
+static int failures = 0;
+
+inline void check(bool condition, const char* description, int line)
+{
+	if (!condition) {
+		std::cerr << __FILE__ << ":" << line << ": check failed: " << description << "\n";
+		++failures;
+	}
+}
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+/// A mock WebDriver with a single element on its page.
+inline std::shared_ptr<wdlite::Endpoint> make_mock_endpoint(const std::string& name)
+{
+	const auto file = "wdlite-element-test-" + name + ".tape";
+	const auto path = (std::filesystem::temp_directory_path() / file).string();
+	std::remove(path.c_str());
+	{
+		wdlite::Recorder recorder{ path };
+		recorder.record("POST", "session", R"({"capabilities":{}})",
+		                R"({"value":{"sessionId":")" + name + R"("}})");
+		recorder.record("POST", "session/" + name + "/element",
+		                nlohmann::json{ { "using", "css selector" }, { "value", "p" } }.dump(),
+		                R"({"value":{"element-6066-11e4-a52e-4f735466cecf":")" + name + R"(-p"}})");
+		recorder.record("DELETE", "session/" + name, {}, R"({"value":null})");
+	}
+	auto endpoint = std::make_shared<wdlite::Endpoint>("http://" + name);
+	endpoint->set_replayer(std::make_shared<wdlite::Replayer>(path, 0));
+	return endpoint;
+}
+
+inline asio::awaitable<wdlite::Element> find_paragraph(const std::shared_ptr<wdlite::Session>& session)
+{
+	auto element = co_await session->async_find_element("p", wdlite::LocatorStrategy::css_selector,
+	                                                    asio::use_awaitable);
+	co_return std::move(element).value();
+}
+
+inline asio::awaitable<void> run()
+{
+	const auto executor = co_await asio::this_coro::executor;
+	auto first = co_await wdlite::async_new_session(executor, make_mock_endpoint("first"),
+	                                                nlohmann::json::object(), asio::use_awaitable);
+	const auto second = co_await wdlite::async_new_session(executor, make_mock_endpoint("second"),
+	                                                       nlohmann::json::object(), asio::use_awaitable);
+
+	auto element = co_await find_paragraph(first);
+	const auto other = co_await find_paragraph(second);
+	CHECK(first->get_statistics().elements == 1);
+	CHECK(second->get_statistics().elements == 1);
+
+	// The element holds the last handle of the first session, which is destroyed by the assignment. Borrowed
+	// sessions are destroyed without a final request.
+	first->set_ownership(wdlite::Ownership::borrowed);
+	const std::weak_ptr<wdlite::Session> destroyed = first;
+	first = nullptr;
+	element = other;
+	CHECK(destroyed.expired());
+	CHECK(element.get_id() == "second-p");
+	CHECK(second->get_statistics().elements == 2);
+
+	auto moved = co_await find_paragraph(second);
+	CHECK(second->get_statistics().elements == 3);
+	element = std::move(moved);
+	CHECK(second->get_statistics().elements == 2);
+}
+
+int main()
+{
+	asio::io_service service{};
+	asio::co_spawn(service, run(), [](std::exception_ptr exception) {
+		if (exception != nullptr) {
+			try {
+				std::rethrow_exception(exception);
+			} catch (const std::exception& e) {
+				std::cerr << "unexpected exception: " << e.what() << "\n";
+				++failures;
+			}
+		}
+	});
+	service.run();
+
+	if (failures > 0) {
+		std::cerr << failures << " checks failed\n";
+		return 1;
+	}
+	return 0;
+}
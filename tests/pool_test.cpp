@@ -0,0 +1,173 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <wdlite/wdlite.hpp>
+
+namespace asio = CURLIO_ASIO_NS;
+
+static int failures = 0;
+
+inline void check(bool condition, const char* description, int line)
+{
+	if (!condition) {
+		std::cerr << __FILE__ << ":" << line << ": check failed: " << description << "\n";
+		++failures;
+	}
+}
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+inline std::string make_tape_path(const std::string& name)
+{
+	const auto path = std::filesystem::temp_directory_path() / ("wdlite-pool-test-" + name + ".tape");
+	std::remove(path.string().c_str());
+	return path.string();
+}
+
+/// A mock WebDriver which answers every request after `latency` from a tape. `session` is the response to new
+/// sessions.
+inline std::shared_ptr<wdlite::Endpoint> make_mock_endpoint(const std::string& name, bool ready,
+                                                             std::chrono::milliseconds latency,
+                                                             std::string session = {})
+{
+	const auto path = make_tape_path(name);
+	{
+		wdlite::Recorder recorder{ path };
+		recorder.record("GET", "status", {},
+		                ready ? R"({"value":{"ready":true}})" : R"({"value":{"ready":false}})", latency);
+		for (int i = 0; i < 4; ++i) {
+			recorder.record("POST", "session", R"({"capabilities":{}})",
+			                session.empty() ? R"({"value":{"sessionId":")" + name + std::to_string(i) + "\"}}"
+			                                : session,
+			                latency);
+		}
+	}
+	auto endpoint = std::make_shared<wdlite::Endpoint>("http://" + name);
+	endpoint->set_replayer(std::make_shared<wdlite::Replayer>(path));
+	return endpoint;
+}
+
+/// A WebDriver which cannot be reached. Its tape is empty, so every command fails without an answer.
+inline std::shared_ptr<wdlite::Endpoint> make_failing_endpoint(const std::string& name)
+{
+	const auto path = make_tape_path(name);
+	wdlite::Recorder{ path };
+	auto endpoint = std::make_shared<wdlite::Endpoint>("http://" + name);
+	endpoint->set_replayer(std::make_shared<wdlite::Replayer>(path));
+	return endpoint;
+}
+
+/// The error of `async_new_session()` which is expected to fail.
+inline asio::awaitable<curlio::detail::asio_error_code>
+  fail_new_session(std::shared_ptr<wdlite::EndpointPool> pool)
+{
+	const auto executor = co_await asio::this_coro::executor;
+	curlio::detail::asio_error_code ec;
+	bool done = false;
+	wdlite::async_new_session(
+	  executor, std::move(pool), nlohmann::json::object(),
+	  [&](curlio::detail::asio_error_code error, std::shared_ptr<wdlite::Session> /* session */) {
+		  ec = error;
+		  done = true;
+	  });
+	asio::steady_timer timer{ executor };
+	while (!done) {
+		timer.expires_after(std::chrono::milliseconds{ 1 });
+		co_await timer.async_wait(asio::use_awaitable);
+	}
+	co_return ec;
+}
+
+inline asio::awaitable<void> run()
+{
+	const auto executor = co_await asio::this_coro::executor;
+	const auto fast = make_mock_endpoint("fast", true, std::chrono::milliseconds{ 5 });
+	const auto slow = make_mock_endpoint("slow", true, std::chrono::milliseconds{ 30 });
+	const auto busy = make_mock_endpoint("busy", false, std::chrono::milliseconds{ 5 });
+	const auto unreachable = make_failing_endpoint("unreachable");
+	const auto pool = std::make_shared<wdlite::EndpointPool>(std::vector{ slow, unreachable, busy, fast });
+
+	// Health checks mark endpoints which are not ready or cannot be reached as down.
+	const auto healthy = co_await pool->async_check_health(executor, asio::use_awaitable);
+	CHECK(healthy == 2);
+	CHECK(fast->is_healthy());
+	CHECK(slow->is_healthy());
+	CHECK(!busy->is_healthy());
+	CHECK(!unreachable->is_healthy());
+	CHECK(fast->get_latency() < slow->get_latency());
+
+	// The endpoint with the fewest sessions wins and the lower latency breaks ties.
+	std::vector<std::shared_ptr<wdlite::Session>> sessions;
+	for (const auto& expected : { fast, slow, fast }) {
+		sessions.push_back(co_await wdlite::async_new_session(executor, pool, nlohmann::json::object(),
+		                                                      asio::use_awaitable));
+		CHECK(sessions.back()->get_endpoint() == expected);
+	}
+	CHECK(fast->get_session_count() == 2);
+	CHECK(slow->get_session_count() == 1);
+
+	// Without sessions and latency the unreachable endpoint ranks first. The failed request marks it down and
+	// the next endpoint is tried.
+	unreachable->set_healthy(true);
+	CHECK(pool->rank().front() == unreachable);
+	sessions.push_back(
+	  co_await wdlite::async_new_session(executor, pool, nlohmann::json::object(), asio::use_awaitable));
+	CHECK(sessions.back()->get_endpoint() == slow);
+	CHECK(!unreachable->is_healthy());
+
+	// An endpoint which refuses the session stays healthy but the next one is tried.
+	const auto full = make_mock_endpoint("full", true, std::chrono::milliseconds{ 5 },
+	                                     R"({"value":{"error":"session not created","message":"full"}})");
+	pool->add_endpoint(full);
+	CHECK(pool->rank().front() == full);
+	sessions.push_back(
+	  co_await wdlite::async_new_session(executor, pool, nlohmann::json::object(), asio::use_awaitable));
+	CHECK(sessions.back()->get_endpoint() == fast);
+	CHECK(full->is_healthy());
+
+	// The error of the WebDriver is reported once every endpoint refused the session.
+	fast->set_healthy(false);
+	slow->set_healthy(false);
+	CHECK(co_await fail_new_session(pool) == wdlite::Code::session_not_created);
+
+	// Without healthy endpoints no session can be created.
+	full->set_healthy(false);
+	CHECK(co_await fail_new_session(pool) == wdlite::Code::no_healthy_endpoint);
+
+	// An answer after the deadline of the health check does not change the health anymore.
+	const auto late = make_mock_endpoint("late", true, std::chrono::milliseconds{ 100 });
+	const auto late_pool = std::make_shared<wdlite::EndpointPool>(std::vector{ late });
+	late_pool->set_health_check_timeout(std::chrono::milliseconds{ 20 });
+	CHECK(co_await late_pool->async_check_health(executor, asio::use_awaitable) == 0);
+	asio::steady_timer timer{ executor, std::chrono::milliseconds{ 200 } };
+	co_await timer.async_wait(asio::use_awaitable);
+	CHECK(!late->is_healthy());
+
+	// The tapes do not know how to delete the sessions.
+	for (const auto& session : sessions) {
+		session->set_ownership(wdlite::Ownership::borrowed);
+	}
+}
+
+int main()
+{
+	asio::io_service service{};
+	asio::co_spawn(service, run(), [](std::exception_ptr exception) {
+		if (exception != nullptr) {
+			try {
+				std::rethrow_exception(exception);
+			} catch (const std::exception& e) {
+				std::cerr << "unexpected exception: " << e.what() << "\n";
+				++failures;
+			}
+		}
+	});
+	service.run();
+
+	if (failures > 0) {
+		std::cerr << failures << " checks failed\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,266 @@
+#pragma once
+
+#include "element.hpp"
+#include "keys.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace wdlite {
+
+enum class PointerType {
+	mouse,
+	pen,
+	touch,
+};
+
+enum class MouseButton {
+	left,
+	middle,
+	right,
+};
+
+/**
+ * Builder for a W3C action sequence (see [here](https://w3c.github.io/webdriver/#actions)). All input sources
+ * are sent in a single request with `Session::async_perform_actions()`.
+ *
+ * The sources are executed in parallel tick by tick, i.e. the n-th action of every source belongs to the same
+ * tick. Use `synchronize()` to let actions added afterwards start after everything added before.
+ *
+ * ```cpp
+ * wdlite::Actions actions{};
+ * auto& keyboard = actions.add_key_input();
+ * auto& mouse = actions.add_pointer_input();
+ * mouse.click(username_field);
+ * actions.synchronize();
+ * keyboard.type("username").press(wdlite::key::tab).type("password").press(wdlite::key::enter);
+ * co_await session->async_perform_actions(actions, asio::use_awaitable);
+ * ```
+ */
+class Actions {
+public:
+	using duration = std::chrono::milliseconds;
+
+	template<typename Derived>
+	class Source {
+	public:
+		/// Does nothing for at least the given duration in this tick.
+		Derived& pause(duration time = {})
+		{
+			_add(nlohmann::json{ { "type", "pause" }, { "duration", time.count() } });
+			return static_cast<Derived&>(*this);
+		}
+		/// The number of ticks this source participates in.
+		std::size_t size() const noexcept { return _json["actions"].size(); }
+
+	protected:
+		friend Actions;
+
+		nlohmann::json _json;
+
+		Source(std::string_view type, std::string id)
+		    : _json{ { "type", type }, { "id", std::move(id) }, { "actions", nlohmann::json::array() } }
+		{}
+		void _add(nlohmann::json action) { _json["actions"].push_back(std::move(action)); }
+		friend void to_json(nlohmann::json& json, const Source& value) { json = value._json; }
+	};
+
+	class KeyInput : public Source<KeyInput> {
+	public:
+		/// Presses the key. `key` must be a single code point like `key::shift` or `"a"`.
+		KeyInput& key_down(std::string_view key)
+		{
+			_add(nlohmann::json{ { "type", "keyDown" }, { "value", key } });
+			return *this;
+		}
+		/// Releases the key. `key` must be a single code point like `key::shift` or `"a"`.
+		KeyInput& key_up(std::string_view key)
+		{
+			_add(nlohmann::json{ { "type", "keyUp" }, { "value", key } });
+			return *this;
+		}
+		/// Presses and releases the key.
+		KeyInput& press(std::string_view key) { return key_down(key).key_up(key); }
+		/// Presses all keys of the chord in order and releases them in reverse order.
+		KeyInput& press(const key::Chord& chord)
+		{
+			const auto keys = chord.keys();
+			_for_each_key(keys, [this](std::string_view key) { key_down(key); });
+			_for_each_key(keys, [this](std::string_view key) { key_up(key); }, true);
+			return *this;
+		}
+		/// Presses and releases every code point of `text`.
+		KeyInput& type(std::string_view text)
+		{
+			_for_each_key(text, [this](std::string_view key) { press(key); });
+			return *this;
+		}
+
+	private:
+		friend Actions;
+
+		using Source::Source;
+
+		template<typename Function>
+		static void _for_each_key(std::string_view text, Function&& function, bool reverse = false)
+		{
+			if (reverse) {
+				auto end = text.size();
+				while (end > 0) {
+					auto begin = end - 1;
+					// Skip UTF-8 continuation bytes.
+					while (begin > 0 && (static_cast<unsigned char>(text[begin]) & 0xc0) == 0x80) {
+						--begin;
+					}
+					function(text.substr(begin, end - begin));
+					end = begin;
+				}
+			} else {
+				for (std::size_t i = 0; i < text.size();) {
+					const auto length =
+					  std::max<std::size_t>(detail::utf8_sequence_length(static_cast<unsigned char>(text[i])), 1);
+					function(text.substr(i, length));
+					i += length;
+				}
+			}
+		}
+	};
+
+	class PointerInput : public Source<PointerInput> {
+	public:
+		/// Moves the pointer to the absolute viewport coordinates.
+		PointerInput& move_to(int x, int y, duration time = {})
+		{
+			return _move(x, y, time, "viewport");
+		}
+		/// Moves the pointer relative to the center of the element.
+		PointerInput& move_to(const Element& element, int x = 0, int y = 0, duration time = {})
+		{
+			return _move(x, y, time, element);
+		}
+		/// Moves the pointer relative to its current position.
+		PointerInput& move_by(int x, int y, duration time = {}) { return _move(x, y, time, "pointer"); }
+		PointerInput& down(MouseButton button = MouseButton::left)
+		{
+			_add(nlohmann::json{ { "type", "pointerDown" }, { "button", static_cast<int>(button) } });
+			return *this;
+		}
+		PointerInput& up(MouseButton button = MouseButton::left)
+		{
+			_add(nlohmann::json{ { "type", "pointerUp" }, { "button", static_cast<int>(button) } });
+			return *this;
+		}
+		/// Clicks at the current position.
+		PointerInput& click(MouseButton button = MouseButton::left) { return down(button).up(button); }
+		/// Moves to the center of the element and clicks it.
+		PointerInput& click(const Element& element, MouseButton button = MouseButton::left)
+		{
+			return move_to(element).click(button);
+		}
+		PointerInput& double_click(MouseButton button = MouseButton::left) { return click(button).click(button); }
+
+	private:
+		friend Actions;
+
+		PointerInput(std::string id, PointerType type) : Source{ "pointer", std::move(id) }
+		{
+			constexpr std::string_view types[] = { "mouse", "pen", "touch" };
+			_json["parameters"] = nlohmann::json{ { "pointerType", types[static_cast<int>(type)] } };
+		}
+		template<typename Origin>
+		PointerInput& _move(int x, int y, duration time, const Origin& origin)
+		{
+			_add(nlohmann::json{ { "type", "pointerMove" },
+			                     { "x", x },
+			                     { "y", y },
+			                     { "duration", time.count() },
+			                     { "origin", origin } });
+			return *this;
+		}
+	};
+
+	class WheelInput : public Source<WheelInput> {
+	public:
+		/// Scrolls by the delta at the absolute viewport coordinates.
+		WheelInput& scroll(int x, int y, int delta_x, int delta_y, duration time = {})
+		{
+			return _scroll(x, y, delta_x, delta_y, time, "viewport");
+		}
+		/// Scrolls by the delta with the center of the element as origin.
+		WheelInput& scroll(const Element& element, int delta_x, int delta_y, duration time = {})
+		{
+			return _scroll(0, 0, delta_x, delta_y, time, element);
+		}
+
+	private:
+		friend Actions;
+
+		using Source::Source;
+
+		template<typename Origin>
+		WheelInput& _scroll(int x, int y, int delta_x, int delta_y, duration time, const Origin& origin)
+		{
+			_add(nlohmann::json{ { "type", "scroll" },
+			                     { "x", x },
+			                     { "y", y },
+			                     { "deltaX", delta_x },
+			                     { "deltaY", delta_y },
+			                     { "duration", time.count() },
+			                     { "origin", origin } });
+			return *this;
+		}
+	};
+
+	/// Adds a new keyboard. The returned reference stays valid for the lifetime of this object.
+	KeyInput& add_key_input(std::string id = "keyboard")
+	{
+		return std::get<KeyInput>(_sources.emplace_back(KeyInput{ "key", std::move(id) }));
+	}
+	/// Adds a new pointer device. The returned reference stays valid for the lifetime of this object.
+	PointerInput& add_pointer_input(std::string id = "mouse", PointerType type = PointerType::mouse)
+	{
+		return std::get<PointerInput>(_sources.emplace_back(PointerInput{ std::move(id), type }));
+	}
+	/// Adds a new wheel device. The returned reference stays valid for the lifetime of this object.
+	WheelInput& add_wheel_input(std::string id = "wheel")
+	{
+		return std::get<WheelInput>(_sources.emplace_back(WheelInput{ "wheel", std::move(id) }));
+	}
+	/// Pads all sources with pauses so that every action added afterwards starts after all previous ones.
+	Actions& synchronize()
+	{
+		std::size_t ticks = 0;
+		for (const auto& source : _sources) {
+			ticks = std::max(ticks, std::visit([](const auto& s) { return s.size(); }, source));
+		}
+		for (auto& source : _sources) {
+			std::visit(
+			  [ticks](auto& s) {
+				  while (s.size() < ticks) {
+					  s.pause();
+				  }
+			  },
+			  source);
+		}
+		return *this;
+	}
+	bool empty() const noexcept { return _sources.empty(); }
+
+	friend void to_json(nlohmann::json& json, const Actions& value)
+	{
+		json = nlohmann::json::array();
+		for (const auto& source : value._sources) {
+			std::visit([&](const auto& s) { json.push_back(s); }, source);
+		}
+	}
+
+private:
+	std::deque<std::variant<KeyInput, PointerInput, WheelInput>> _sources;
+};
+
+} // namespace wdlite
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace wdlite {
+
+/// Statistics of the locator cache of a session. See `Session::get_locator_cache_statistics()`.
+struct LocatorCacheStatistics {
+	/// The number of lookups answered from the cache.
+	std::size_t hits = 0;
+	/// The number of lookups sent to the remote end while the cache was enabled.
+	std::size_t misses = 0;
+	/// The number of times non-empty cache contents were dropped.
+	std::size_t invalidations = 0;
+	/// The number of cached lookups.
+	std::size_t size = 0;
+};
+
+namespace detail {
+
+/// Maps element lookups to the IDs of the found elements. Disabled by default.
+class LocatorCache {
+public:
+	using Ids = std::vector<std::string>;
+
+	/// If more entries would be stored, the cache is cleared first.
+	constexpr static std::size_t max_size = 4096;
+
+	void set_enabled(bool enabled)
+	{
+		_enabled = enabled;
+		if (!enabled) {
+			invalidate();
+		}
+	}
+	bool is_enabled() const noexcept { return _enabled; }
+	/// Every invalidation starts a new generation. Results of lookups started before are not stored.
+	std::size_t get_generation() const noexcept { return _generation; }
+	LocatorCacheStatistics get_statistics() const noexcept
+	{
+		auto statistics = _statistics;
+		statistics.size = _entries.size();
+		return statistics;
+	}
+	const Ids* find(const std::string& key) noexcept
+	{
+		if (const auto it = _entries.find(key); it != _entries.end()) {
+			++_statistics.hits;
+			return &it->second;
+		}
+		++_statistics.misses;
+		return nullptr;
+	}
+	void insert(std::string key, Ids ids, std::size_t generation)
+	{
+		if (!_enabled || generation != _generation) {
+			return;
+		}
+		if (_entries.size() >= max_size) {
+			invalidate();
+		}
+		_entries.insert_or_assign(std::move(key), std::move(ids));
+	}
+	void invalidate() noexcept
+	{
+		++_generation;
+		if (!_entries.empty()) {
+			++_statistics.invalidations;
+			_entries.clear();
+		}
+	}
+
+private:
+	bool _enabled = false;
+	std::size_t _generation = 0;
+	std::unordered_map<std::string, Ids> _entries;
+	LocatorCacheStatistics _statistics;
+};
+
+} // namespace detail
+
+} // namespace wdlite
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "chrome.hpp"
+
+#include <optional>
+#include <string>
+
+namespace wdlite::capabilities {
+
+/**
+ * Typed performance settings for Chrome which are turned into command-line arguments by `apply()`. Start
+ * with one of the presets and adjust single fields if needed:
+ *
+ * ```cpp
+ * auto preset = wdlite::capabilities::ChromePreset::throughput_scraping();
+ * preset.renderer_process_limit = 4;
+ * const auto capabilities = wdlite::capabilities::make(wdlite::capabilities::Capabilities{
+ *   .browser_specific = preset.apply(),
+ * });
+ * ```
+ *
+ * `examples/preset_benchmark.cpp` compares the page load time and the memory usage of the presets.
+ */
+struct ChromePreset {
+	struct WindowSize {
+		unsigned int width = 1280;
+		unsigned int height = 720;
+	};
+
+	/// Runs Chrome without a window using the new headless mode.
+	bool headless = true;
+	/// Whether images are loaded and decoded.
+	bool images = true;
+	/// Without the GPU no GPU process is started and everything is rendered in software.
+	bool gpu = true;
+	/// Whether extensions and component extensions with background pages are loaded.
+	bool extensions = true;
+	/// Chrome slows down timers and renderers of pages which are not visible. Pages which are driven in
+	/// parallel in multiple windows should disable this.
+	bool background_throttling = true;
+	/// Update checks, safe browsing and other traffic which is unrelated to the pages.
+	bool background_networking = true;
+	/// Whether every site gets its own renderer process. Disabling it lets sites share renderer processes.
+	bool site_isolation = true;
+	/// The maximum number of renderer processes. `0` keeps the default of Chrome.
+	unsigned int renderer_process_limit = 0;
+	/// The maximum size of the JavaScript heap of a renderer in MiB. `0` keeps the default of Chrome.
+	unsigned int js_heap_limit = 0;
+	/// Trades speed for memory like on devices with less than 1 GiB of memory.
+	bool low_end_device_mode = false;
+	/// The default of Chrome if not set.
+	std::optional<WindowSize> window_size;
+
+	/// Loads many pages as fast as possible at the cost of what is not needed for scraping their content.
+	static ChromePreset throughput_scraping() noexcept
+	{
+		ChromePreset preset{};
+		preset.images = false;
+		preset.gpu = false;
+		preset.extensions = false;
+		preset.background_throttling = false;
+		preset.background_networking = false;
+		preset.renderer_process_limit = 2;
+		preset.window_size = WindowSize{ 800, 600 };
+		return preset;
+	}
+	/// Keeps the memory usage of the browser low at the cost of speed. Suited for many browsers on one host.
+	static ChromePreset low_memory() noexcept
+	{
+		ChromePreset preset{};
+		preset.images = false;
+		preset.gpu = false;
+		preset.extensions = false;
+		preset.background_networking = false;
+		preset.site_isolation = false;
+		preset.renderer_process_limit = 1;
+		preset.js_heap_limit = 512;
+		preset.low_end_device_mode = true;
+		preset.window_size = WindowSize{ 800, 600 };
+		return preset;
+	}
+
+	/**
+	 * Appends the arguments of this preset to the ones of `options`. Other options like the binary are kept.
+	 * `options` must not contain `--disable-features` or `--js-flags` because Chrome only uses the last one of
+	 * each.
+	 */
+	ChromeOptions apply(ChromeOptions options = {}) const
+	{
+		auto& arguments = options.arguments;
+		if (headless) {
+			arguments.push_back("--headless=new");
+		}
+		if (!images) {
+			arguments.push_back("--blink-settings=imagesEnabled=false");
+		}
+		if (!gpu) {
+			arguments.push_back("--disable-gpu");
+		}
+		if (!extensions) {
+			arguments.push_back("--disable-extensions");
+			arguments.push_back("--disable-component-extensions-with-background-pages");
+		}
+		if (!background_throttling) {
+			arguments.push_back("--disable-background-timer-throttling");
+			arguments.push_back("--disable-backgrounding-occluded-windows");
+			arguments.push_back("--disable-renderer-backgrounding");
+		}
+		if (!background_networking) {
+			arguments.push_back("--disable-background-networking");
+			arguments.push_back("--disable-component-update");
+			arguments.push_back("--disable-sync");
+		}
+		if (!site_isolation) {
+			arguments.push_back("--disable-site-isolation-trials");
+			arguments.push_back("--disable-features=IsolateOrigins,site-per-process");
+		}
+		if (renderer_process_limit != 0) {
+			arguments.push_back("--renderer-process-limit=" + std::to_string(renderer_process_limit));
+		}
+		if (js_heap_limit != 0) {
+			arguments.push_back("--js-flags=--max-old-space-size=" + std::to_string(js_heap_limit));
+		}
+		if (low_end_device_mode) {
+			arguments.push_back("--enable-low-end-device-mode");
+		}
+		if (window_size.has_value()) {
+			arguments.push_back("--window-size=" + std::to_string(window_size->width) + "," +
+			                    std::to_string(window_size->height));
+		}
+		return options;
+	}
+};
+
+} // namespace wdlite::capabilities
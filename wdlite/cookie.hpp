@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+
+namespace wdlite {
+
+/// A cookie as described [here](https://w3c.github.io/webdriver/#cookies).
+struct Cookie {
+	std::string name;
+	std::string value;
+	/// The cookie path. Defaults to `/` if empty.
+	std::string path;
+	/// The domain the cookie is visible to. Defaults to the domain of the current page if empty.
+	std::string domain;
+	bool secure = false;
+	bool http_only = false;
+	/// Seconds since the Unix epoch when the cookie expires. Session cookies have no expiry.
+	std::optional<std::int64_t> expiry;
+	/// Either `Lax`, `Strict` or `None`.
+	std::string same_site;
+};
+
+inline void to_json(nlohmann::json& json, const Cookie& value)
+{
+	json = nlohmann::json{
+		{ "name", value.name },
+		{ "value", value.value },
+		{ "secure", value.secure },
+		{ "httpOnly", value.http_only },
+	};
+
+	if (!value.path.empty()) {
+		json["path"] = value.path;
+	}
+	if (!value.domain.empty()) {
+		json["domain"] = value.domain;
+	}
+	if (value.expiry.has_value()) {
+		json["expiry"] = value.expiry.value();
+	}
+	if (!value.same_site.empty()) {
+		json["sameSite"] = value.same_site;
+	}
+}
+
+inline void from_json(const nlohmann::json& json, Cookie& value)
+{
+	value.name = json.at("name").get<std::string>();
+	value.value = json.at("value").get<std::string>();
+	value.path = json.value("path", "");
+	value.domain = json.value("domain", "");
+	value.secure = json.value("secure", false);
+	value.http_only = json.value("httpOnly", false);
+	if (const auto it = json.find("expiry"); it != json.end() && it->is_number()) {
+		value.expiry = it->get<std::int64_t>();
+	} else {
+		value.expiry.reset();
+	}
+	value.same_site = json.value("sameSite", "");
+}
+
+} // namespace wdlite
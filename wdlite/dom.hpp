@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace wdlite {
+
+class DomSnapshot;
+
+namespace detail {
+
+class CssEngine;
+class XPathEngine;
+
+} // namespace detail
+
+enum class DomNodeType : std::uint8_t {
+	element,
+	text,
+};
+
+/// A lightweight handle to a node of a `DomSnapshot`. The snapshot must outlive the handle.
+class DomNode {
+public:
+	std::uint32_t get_index() const noexcept;
+	DomNodeType get_type() const noexcept;
+	bool is_element() const noexcept;
+	/// The lowercase tag name of an element or an empty string for text nodes.
+	std::string_view get_tag_name() const noexcept;
+	std::optional<std::string_view> get_attribute(std::string_view name) const noexcept;
+	/// All attributes as name-value pairs in document order.
+	std::vector<std::pair<std::string_view, std::string_view>> get_attributes() const;
+	/// The content of a text node or the concatenated text of all descendants of an element.
+	std::string get_text() const;
+	/// Whether the element was visible when the snapshot was taken. Always `true` without computed visibility.
+	bool is_visible() const noexcept;
+
+	std::optional<DomNode> get_parent() const noexcept;
+	std::optional<DomNode> get_first_child() const noexcept;
+	std::optional<DomNode> get_next_sibling() const noexcept;
+	std::optional<DomNode> get_previous_sibling() const noexcept;
+	/// The number of descendants of this node.
+	std::size_t get_descendant_count() const noexcept;
+
+	/// Finds all descendant elements matching the CSS selector in document order.
+	std::vector<DomNode> select(std::string_view selector) const;
+	std::optional<DomNode> select_first(std::string_view selector) const;
+	/// Evaluates the XPath expression with this node as context node.
+	std::vector<DomNode> select_xpath(std::string_view xpath) const;
+
+	friend bool operator==(const DomNode& left, const DomNode& right) noexcept
+	{
+		return left._snapshot == right._snapshot && left._index == right._index;
+	}
+	friend bool operator!=(const DomNode& left, const DomNode& right) noexcept { return !(left == right); }
+
+private:
+	friend DomSnapshot;
+	friend detail::XPathEngine;
+
+	const DomSnapshot* _snapshot;
+	std::uint32_t _index;
+
+	DomNode(const DomSnapshot* snapshot, std::uint32_t index) noexcept
+	    : _snapshot{ snapshot }, _index{ index }
+	{}
+};
+
+/**
+ * A read-only copy of a DOM subtree taken with `Session::async_snapshot_dom()`. Elements and non-whitespace
+ * text nodes are stored in document order in a contiguous arena and all strings share a single buffer, so a
+ * snapshot of 100k nodes needs only a handful of allocations.
+ *
+ * The CSS engine supports type, universal, ID, class and attribute selectors (`=`, `~=`, `|=`, `^=`, `$=`,
+ * `*=`), the pseudo-classes `:first-child`, `:last-child`, `:only-child`, `:nth-child()`,
+ * `:nth-last-child()`, `:empty` and `:not()` as well as all four combinators and selector lists. The XPath
+ * engine supports unions of location paths with `/`, `//`, `.`, `..`, name tests, `*`, `text()` and
+ * `node()`, and predicates with positions, `position()`, `last()`, `@attribute`, child names, `text()`,
+ * comparisons, `and`, `or`, `not()`, `contains()`, `starts-with()` and `normalize-space()`. Invalid or
+ * unsupported expressions throw `std::invalid_argument`.
+ *
+ * ```cpp
+ * const auto snapshot = co_await session->async_snapshot_dom({}, asio::use_awaitable);
+ * for (const auto& link : snapshot.select("nav a[href^='https']")) {
+ *   std::cout << link.get_text() << ": " << *link.get_attribute("href") << "\n";
+ * }
+ * ```
+ */
+class DomSnapshot {
+public:
+	/// The index of a missing node.
+	constexpr static std::uint32_t npos = UINT32_MAX;
+
+	struct Options {
+		/// Computes the visibility of every element. This makes the snapshot considerably slower.
+		bool visibility = false;
+	};
+
+	DomSnapshot() = default;
+
+	bool empty() const noexcept;
+	/// The number of nodes.
+	std::size_t size() const noexcept;
+	/// The root of the snapshot. The snapshot must not be empty.
+	DomNode get_root() const noexcept;
+	DomNode operator[](std::uint32_t index) const noexcept;
+
+	/// Finds all elements matching the CSS selector in document order including the root.
+	std::vector<DomNode> select(std::string_view selector) const;
+	std::optional<DomNode> select_first(std::string_view selector) const;
+	/// Evaluates the XPath expression. Relative paths start at the document containing the root.
+	std::vector<DomNode> select_xpath(std::string_view xpath) const;
+
+	/**
+	 * Decodes the snapshot from the compact format produced by the snapshot script.
+	 *
+	 * @param strings The string table where the strings are separated by NUL characters.
+	 * @param nodes The comma separated node stream.
+	 */
+	static DomSnapshot decode(std::string strings, std::string_view nodes);
+
+private:
+	friend DomNode;
+	friend detail::CssEngine;
+	friend detail::XPathEngine;
+
+	struct Node {
+		std::uint32_t parent = npos;
+		std::uint32_t first_child = npos;
+		std::uint32_t next_sibling = npos;
+		std::uint32_t previous_sibling = npos;
+		/// One past the last descendant. The descendants are stored contiguously after the node.
+		std::uint32_t end = 0;
+		/// The tag name of elements and the content of text nodes as index into the string table.
+		std::uint32_t name = 0;
+		std::uint32_t attributes_begin = 0;
+		std::uint32_t attributes_end = 0;
+		/// The 1-based position among the element siblings. Used to answer `:nth-child()` in constant time.
+		std::uint32_t element_position = 1;
+		std::uint32_t element_children = 0;
+		DomNodeType type = DomNodeType::element;
+		bool visible = true;
+	};
+
+	/// All strings separated by NUL characters.
+	std::string _buffer;
+	/// Offset and size in `_buffer` of every string.
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> _strings;
+	std::vector<Node> _nodes;
+	/// Name and value of the attributes of all nodes.
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> _attributes;
+	/// Tag and attribute names which occur in the snapshot. Used to resolve the names of selectors once.
+	std::unordered_map<std::string, std::uint32_t> _names;
+
+	std::string_view _string(std::uint32_t index) const noexcept;
+	/// The string index of the tag or attribute name or `npos` if it does not occur.
+	std::uint32_t _find_name(std::string_view name) const;
+	std::vector<DomNode> _select(std::string_view selector, std::uint32_t begin, std::uint32_t end,
+	                             bool first) const;
+	std::vector<DomNode> _select_xpath(std::string_view xpath, std::uint32_t context) const;
+};
+
+} // namespace wdlite
@@ -0,0 +1,1352 @@
+#include "dom.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+
+namespace wdlite {
+
+namespace detail {
+
+inline bool is_css_whitespace(char c) noexcept
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+/// Whether `list` contains `token` as whitespace separated item.
+inline bool contains_token(std::string_view list, std::string_view token) noexcept
+{
+	std::size_t begin = 0;
+	while (begin < list.size()) {
+		while (begin < list.size() && is_css_whitespace(list[begin])) {
+			++begin;
+		}
+		auto end = begin;
+		while (end < list.size() && !is_css_whitespace(list[end])) {
+			++end;
+		}
+		if (end > begin && list.substr(begin, end - begin) == token) {
+			return true;
+		}
+		begin = end;
+	}
+	return false;
+}
+
+/// Parses and matches CSS selectors against the elements of a snapshot.
+class CssEngine {
+public:
+	CssEngine(const DomSnapshot& snapshot, std::string_view selector)
+	    : _snapshot{ snapshot }, _input{ selector }
+	{
+		_class = snapshot._find_name("class");
+		_id = snapshot._find_name("id");
+		do {
+			_skip_whitespace();
+			_selectors.push_back(_parse_complex());
+			_skip_whitespace();
+		} while (_consume(','));
+		if (_position != _input.size()) {
+			_fail();
+		}
+	}
+
+	bool matches(std::uint32_t node) const noexcept
+	{
+		if (_snapshot._nodes[node].type != DomNodeType::element) {
+			return false;
+		}
+		for (const auto& selector : _selectors) {
+			if (_matches(selector, selector.compounds.size() - 1, node)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+private:
+	struct AttributeTest {
+		/// `npos` if the attribute does not occur in the snapshot.
+		std::uint32_t name;
+		/// `0` tests for existence, otherwise the first character of the operator.
+		char op;
+		std::string value;
+	};
+	struct Pseudo {
+		enum class Kind {
+			nth_child,
+			nth_last_child,
+			only_child,
+			empty,
+		};
+
+		Kind kind;
+		int a = 0;
+		int b = 0;
+	};
+	struct Compound {
+		/// `npos` matches any element.
+		std::uint32_t tag = DomSnapshot::npos;
+		/// Set if a name does not occur in the snapshot and the compound can never match.
+		bool impossible = false;
+		std::optional<std::string> id;
+		std::vector<std::string> classes;
+		std::vector<AttributeTest> attributes;
+		std::vector<Pseudo> pseudos;
+		std::vector<Compound> negations;
+	};
+	struct Complex {
+		std::vector<Compound> compounds;
+		/// The combinator between `compounds[i]` and `compounds[i + 1]`.
+		std::vector<char> combinators;
+	};
+
+	const DomSnapshot& _snapshot;
+	std::string_view _input;
+	std::size_t _position = 0;
+	std::uint32_t _class;
+	std::uint32_t _id;
+	std::vector<Complex> _selectors;
+
+	[[noreturn]] void _fail() const
+	{
+		throw std::invalid_argument{ "invalid or unsupported CSS selector: " + std::string{ _input } };
+	}
+	bool _skip_whitespace() noexcept
+	{
+		const auto start = _position;
+		while (_position < _input.size() && is_css_whitespace(_input[_position])) {
+			++_position;
+		}
+		return _position != start;
+	}
+	bool _consume(char c) noexcept
+	{
+		if (_position < _input.size() && _input[_position] == c) {
+			++_position;
+			return true;
+		}
+		return false;
+	}
+	bool _peek_identifier() const noexcept
+	{
+		if (_position >= _input.size()) {
+			return false;
+		}
+		const auto c = static_cast<unsigned char>(_input[_position]);
+		return std::isalnum(c) || c == '-' || c == '_' || c == '\\' || c >= 0x80;
+	}
+	std::string _parse_identifier()
+	{
+		std::string identifier;
+		while (_peek_identifier()) {
+			if (_input[_position] == '\\' && _position + 1 < _input.size()) {
+				++_position;
+			}
+			identifier += _input[_position++];
+		}
+		if (identifier.empty()) {
+			_fail();
+		}
+		return identifier;
+	}
+	std::string _parse_string()
+	{
+		const auto quote = _input[_position++];
+		std::string value;
+		while (_position < _input.size() && _input[_position] != quote) {
+			if (_input[_position] == '\\' && _position + 1 < _input.size()) {
+				++_position;
+			}
+			value += _input[_position++];
+		}
+		if (!_consume(quote)) {
+			_fail();
+		}
+		return value;
+	}
+	Complex _parse_complex()
+	{
+		Complex complex{};
+		complex.compounds.push_back(_parse_compound());
+		while (true) {
+			const bool whitespace = _skip_whitespace();
+			char combinator = ' ';
+			if (_consume('>')) {
+				combinator = '>';
+			} else if (_consume('+')) {
+				combinator = '+';
+			} else if (_consume('~')) {
+				combinator = '~';
+			} else if (!whitespace || _position == _input.size() || _input[_position] == ',') {
+				break;
+			}
+			_skip_whitespace();
+			complex.combinators.push_back(combinator);
+			complex.compounds.push_back(_parse_compound());
+		}
+		return complex;
+	}
+	Compound _parse_compound()
+	{
+		Compound compound{};
+		bool empty = true;
+		if (_consume('*')) {
+			empty = false;
+		} else if (_peek_identifier()) {
+			auto tag = _parse_identifier();
+			std::transform(tag.begin(), tag.end(), tag.begin(),
+			               [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; });
+			compound.tag = _snapshot._find_name(tag);
+			compound.impossible = compound.tag == DomSnapshot::npos;
+			empty = false;
+		}
+
+		while (_position < _input.size()) {
+			if (_consume('#')) {
+				compound.id = _parse_identifier();
+				compound.impossible |= _id == DomSnapshot::npos;
+			} else if (_consume('.')) {
+				compound.classes.push_back(_parse_identifier());
+				compound.impossible |= _class == DomSnapshot::npos;
+			} else if (_consume('[')) {
+				compound.attributes.push_back(_parse_attribute());
+				compound.impossible |= compound.attributes.back().name == DomSnapshot::npos;
+			} else if (_consume(':')) {
+				_parse_pseudo(compound);
+			} else {
+				break;
+			}
+			empty = false;
+		}
+		if (empty) {
+			_fail();
+		}
+		return compound;
+	}
+	AttributeTest _parse_attribute()
+	{
+		_skip_whitespace();
+		AttributeTest test{ _snapshot._find_name(_parse_identifier()), 0, {} };
+		_skip_whitespace();
+		if (!_consume(']')) {
+			if (_consume('=')) {
+				test.op = '=';
+			} else if (_position + 1 < _input.size() && _input[_position + 1] == '=' &&
+			           std::string_view{ "~|^$*" }.find(_input[_position]) != std::string_view::npos) {
+				test.op = _input[_position];
+				_position += 2;
+			} else {
+				_fail();
+			}
+			_skip_whitespace();
+			if (_position < _input.size() && (_input[_position] == '"' || _input[_position] == '\'')) {
+				test.value = _parse_string();
+			} else {
+				test.value = _parse_identifier();
+			}
+			_skip_whitespace();
+			if (!_consume(']')) {
+				_fail();
+			}
+		}
+		return test;
+	}
+	void _parse_pseudo(Compound& compound)
+	{
+		const auto name = _parse_identifier();
+		if (name == "first-child") {
+			compound.pseudos.push_back({ Pseudo::Kind::nth_child, 0, 1 });
+		} else if (name == "last-child") {
+			compound.pseudos.push_back({ Pseudo::Kind::nth_last_child, 0, 1 });
+		} else if (name == "only-child") {
+			compound.pseudos.push_back({ Pseudo::Kind::only_child });
+		} else if (name == "empty") {
+			compound.pseudos.push_back({ Pseudo::Kind::empty });
+		} else if (name == "nth-child" || name == "nth-last-child") {
+			auto pseudo = _parse_nth();
+			pseudo.kind = name == "nth-child" ? Pseudo::Kind::nth_child : Pseudo::Kind::nth_last_child;
+			compound.pseudos.push_back(pseudo);
+		} else if (name == "not") {
+			if (!_consume('(')) {
+				_fail();
+			}
+			_skip_whitespace();
+			compound.negations.push_back(_parse_compound());
+			_skip_whitespace();
+			if (!_consume(')')) {
+				_fail();
+			}
+		} else {
+			_fail();
+		}
+	}
+	/// Parses the `an+b` argument including the parentheses.
+	Pseudo _parse_nth()
+	{
+		const auto end = _input.find(')', _position);
+		if (!_consume('(') || end == std::string_view::npos) {
+			_fail();
+		}
+		std::string argument;
+		for (; _position < end; ++_position) {
+			if (!is_css_whitespace(_input[_position])) {
+				argument += _input[_position];
+			}
+		}
+		++_position;
+
+		Pseudo pseudo{};
+		const auto parse = [this](std::string_view value, int fallback) {
+			if (value.empty() || value == "+") {
+				return fallback;
+			} else if (value == "-") {
+				return -fallback;
+			}
+			int result = 0;
+			const auto first = value.data() + (value.front() == '+' ? 1 : 0);
+			const auto [last, error] = std::from_chars(first, value.data() + value.size(), result);
+			if (error != std::errc{} || last != value.data() + value.size()) {
+				_fail();
+			}
+			return result;
+		};
+		if (argument == "odd") {
+			pseudo.a = 2;
+			pseudo.b = 1;
+		} else if (argument == "even") {
+			pseudo.a = 2;
+		} else if (const auto n = argument.find_first_of("nN"); n != std::string::npos) {
+			pseudo.a = parse(std::string_view{ argument }.substr(0, n), 1);
+			pseudo.b = parse(std::string_view{ argument }.substr(n + 1), 0);
+		} else {
+			pseudo.b = parse(argument, 0);
+		}
+		return pseudo;
+	}
+
+	/// The previous or next element sibling.
+	std::uint32_t _sibling(std::uint32_t node, bool previous) const noexcept
+	{
+		const auto& nodes = _snapshot._nodes;
+		do {
+			node = previous ? nodes[node].previous_sibling : nodes[node].next_sibling;
+		} while (node != DomSnapshot::npos && nodes[node].type != DomNodeType::element);
+		return node;
+	}
+	bool _matches(const Pseudo& pseudo, std::uint32_t node) const noexcept
+	{
+		switch (pseudo.kind) {
+		case Pseudo::Kind::only_child:
+			return _sibling(node, true) == DomSnapshot::npos && _sibling(node, false) == DomSnapshot::npos;
+		case Pseudo::Kind::empty: return _snapshot._nodes[node].first_child == DomSnapshot::npos;
+		default: break;
+		}
+
+		const auto& element = _snapshot._nodes[node];
+		auto position = static_cast<int>(element.element_position);
+		if (pseudo.kind == Pseudo::Kind::nth_last_child) {
+			const auto siblings =
+			  element.parent == DomSnapshot::npos ? 1 : _snapshot._nodes[element.parent].element_children;
+			position = static_cast<int>(siblings) - position + 1;
+		}
+		if (pseudo.a == 0) {
+			return position == pseudo.b;
+		}
+		const auto difference = position - pseudo.b;
+		return difference / pseudo.a >= 0 && difference % pseudo.a == 0;
+	}
+	bool _matches(const Compound& compound, std::uint32_t node) const noexcept
+	{
+		const auto& element = _snapshot._nodes[node];
+		if (compound.impossible || (compound.tag != DomSnapshot::npos && element.name != compound.tag)) {
+			return false;
+		}
+
+		const auto attribute = [&](std::uint32_t name) -> std::optional<std::string_view> {
+			for (auto i = element.attributes_begin; i < element.attributes_end; ++i) {
+				if (_snapshot._attributes[i].first == name) {
+					return _snapshot._string(_snapshot._attributes[i].second);
+				}
+			}
+			return std::nullopt;
+		};
+		if (compound.id.has_value() && attribute(_id) != std::string_view{ *compound.id }) {
+			return false;
+		}
+		if (!compound.classes.empty()) {
+			const auto classes = attribute(_class);
+			for (const auto& name : compound.classes) {
+				if (!classes.has_value() || !contains_token(*classes, name)) {
+					return false;
+				}
+			}
+		}
+		for (const auto& test : compound.attributes) {
+			const auto value = attribute(test.name);
+			if (!value.has_value()) {
+				return false;
+			}
+			const std::string_view expected = test.value;
+			bool result = true;
+			switch (test.op) {
+			case '=': result = *value == expected; break;
+			case '~': result = contains_token(*value, expected); break;
+			case '|':
+				result = *value == expected ||
+				         (value->size() > expected.size() && value->substr(0, expected.size()) == expected &&
+				          (*value)[expected.size()] == '-');
+				break;
+			case '^': result = !expected.empty() && value->substr(0, expected.size()) == expected; break;
+			case '$':
+				result = !expected.empty() && value->size() >= expected.size() &&
+				         value->substr(value->size() - expected.size()) == expected;
+				break;
+			case '*': result = !expected.empty() && value->find(expected) != std::string_view::npos; break;
+			default: break;
+			}
+			if (!result) {
+				return false;
+			}
+		}
+		for (const auto& pseudo : compound.pseudos) {
+			if (!_matches(pseudo, node)) {
+				return false;
+			}
+		}
+		for (const auto& negation : compound.negations) {
+			if (_matches(negation, node)) {
+				return false;
+			}
+		}
+		return true;
+	}
+	/// Matches the compound `index` and everything left of it from right to left.
+	bool _matches(const Complex& complex, std::size_t index, std::uint32_t node) const noexcept
+	{
+		if (!_matches(complex.compounds[index], node)) {
+			return false;
+		} else if (index == 0) {
+			return true;
+		}
+
+		const auto& nodes = _snapshot._nodes;
+		switch (complex.combinators[index - 1]) {
+		case '>':
+			return nodes[node].parent != DomSnapshot::npos && _matches(complex, index - 1, nodes[node].parent);
+		case '+': {
+			const auto sibling = _sibling(node, true);
+			return sibling != DomSnapshot::npos && _matches(complex, index - 1, sibling);
+		}
+		case '~':
+			for (auto sibling = _sibling(node, true); sibling != DomSnapshot::npos;
+			     sibling = _sibling(sibling, true)) {
+				if (_matches(complex, index - 1, sibling)) {
+					return true;
+				}
+			}
+			return false;
+		default:
+			for (auto ancestor = nodes[node].parent; ancestor != DomSnapshot::npos;
+			     ancestor = nodes[ancestor].parent) {
+				if (_matches(complex, index - 1, ancestor)) {
+					return true;
+				}
+			}
+			return false;
+		}
+	}
+};
+
+/// Parses and evaluates the supported XPath subset on a snapshot.
+class XPathEngine {
+public:
+	/// The context of absolute paths, i.e. the parent of the snapshot root.
+	constexpr static std::uint32_t document = DomSnapshot::npos - 1;
+
+	XPathEngine(const DomSnapshot& snapshot, std::string_view xpath) : _snapshot{ snapshot }, _input{ xpath }
+	{
+		do {
+			_paths.push_back(_parse_path());
+			_skip_whitespace();
+		} while (_consume('|'));
+		if (_position != _input.size()) {
+			_fail();
+		}
+	}
+
+	std::vector<DomNode> evaluate(std::uint32_t context) const
+	{
+		std::vector<std::uint32_t> result;
+		for (const auto& path : _paths) {
+			std::vector<std::uint32_t> nodes{ path.absolute ? document : context };
+			for (const auto& step : path.steps) {
+				nodes = _evaluate(step, nodes);
+			}
+			result.insert(result.end(), nodes.begin(), nodes.end());
+		}
+		if (_paths.size() > 1) {
+			std::sort(result.begin(), result.end());
+			result.erase(std::unique(result.begin(), result.end()), result.end());
+		}
+
+		std::vector<DomNode> nodes;
+		nodes.reserve(result.size());
+		for (const auto node : result) {
+			if (node != document) {
+				nodes.push_back(DomNode{ &_snapshot, node });
+			}
+		}
+		return nodes;
+	}
+
+private:
+	struct Expression {
+		enum class Kind {
+			or_,
+			and_,
+			not_,
+			equal,
+			not_equal,
+			less,
+			less_equal,
+			greater,
+			greater_equal,
+			contains,
+			starts_with,
+			normalize_space,
+			number,
+			position,
+			last,
+			attribute,
+			child,
+			text,
+			self,
+			literal,
+		};
+
+		Kind kind = Kind::self;
+		std::vector<Expression> operands{};
+		std::string literal{};
+		/// The attribute or element name or the number.
+		std::uint32_t value = 0;
+	};
+	enum class Axis {
+		child,
+		descendant,
+		descendant_or_self,
+		self,
+		parent,
+	};
+	enum class Test {
+		name,
+		element,
+		text,
+		node,
+	};
+	struct Step {
+		Axis axis = Axis::child;
+		Test test = Test::node;
+		std::uint32_t name = DomSnapshot::npos;
+		std::vector<Expression> predicates;
+		/// Whether the predicates depend on the position.
+		bool positional = false;
+	};
+	struct Path {
+		bool absolute = false;
+		std::vector<Step> steps;
+	};
+
+	const DomSnapshot& _snapshot;
+	std::string_view _input;
+	std::size_t _position = 0;
+	bool _positional = false;
+	std::vector<Path> _paths;
+
+	[[noreturn]] void _fail() const
+	{
+		throw std::invalid_argument{ "invalid or unsupported XPath: " + std::string{ _input } };
+	}
+	void _skip_whitespace() noexcept
+	{
+		while (_position < _input.size() && is_css_whitespace(_input[_position])) {
+			++_position;
+		}
+	}
+	bool _consume(std::string_view token) noexcept
+	{
+		_skip_whitespace();
+		if (_input.substr(_position, token.size()) == token) {
+			_position += token.size();
+			return true;
+		}
+		return false;
+	}
+	bool _consume(char c) noexcept { return _consume(std::string_view{ &c, 1 }); }
+	std::string_view _parse_name()
+	{
+		_skip_whitespace();
+		const auto start = _position;
+		while (_position < _input.size()) {
+			const auto c = static_cast<unsigned char>(_input[_position]);
+			if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c >= 0x80 ||
+			    (c == ':' && _input.substr(_position, 2) != "::")) {
+				++_position;
+			} else {
+				break;
+			}
+		}
+		if (start == _position) {
+			_fail();
+		}
+		return _input.substr(start, _position - start);
+	}
+	Path _parse_path()
+	{
+		Path path{};
+		bool descendant = false;
+		if (_consume("//")) {
+			path.absolute = descendant = true;
+		} else if (_consume('/')) {
+			path.absolute = true;
+			_skip_whitespace();
+			if (_position == _input.size() || _input[_position] == '|') {
+				return path;
+			}
+		}
+
+		while (true) {
+			auto step = _parse_step();
+			if (descendant) {
+				if (step.axis == Axis::child && !step.positional) {
+					step.axis = Axis::descendant;
+				} else {
+					Step any{};
+					any.axis = Axis::descendant_or_self;
+					path.steps.push_back(std::move(any));
+				}
+			}
+			path.steps.push_back(std::move(step));
+
+			if (_consume("//")) {
+				descendant = true;
+			} else if (_consume('/')) {
+				descendant = false;
+			} else {
+				break;
+			}
+		}
+		return path;
+	}
+	Step _parse_step()
+	{
+		Step step{};
+		if (_consume("..")) {
+			step.axis = Axis::parent;
+			return step;
+		} else if (_consume('.')) {
+			step.axis = Axis::self;
+			return step;
+		}
+
+		constexpr std::pair<std::string_view, Axis> axes[] = {
+			{ "child::", Axis::child },
+			{ "descendant-or-self::", Axis::descendant_or_self },
+			{ "descendant::", Axis::descendant },
+			{ "self::", Axis::self },
+			{ "parent::", Axis::parent },
+		};
+		for (const auto& [prefix, axis] : axes) {
+			if (_consume(prefix)) {
+				step.axis = axis;
+				break;
+			}
+		}
+
+		if (_consume('*')) {
+			step.test = Test::element;
+		} else if (_consume("text()")) {
+			step.test = Test::text;
+		} else if (_consume("node()")) {
+			step.test = Test::node;
+		} else {
+			step.test = Test::name;
+			step.name = _snapshot._find_name(_parse_name());
+		}
+
+		while (_consume('[')) {
+			_positional = false;
+			auto predicate = _parse_or();
+			if (predicate.kind == Expression::Kind::number) {
+				_positional = true;
+			}
+			step.positional |= _positional;
+			step.predicates.push_back(std::move(predicate));
+			if (!_consume(']')) {
+				_fail();
+			}
+		}
+		return step;
+	}
+	Expression _parse_or()
+	{
+		auto left = _parse_and();
+		while (_consume("or")) {
+			left = Expression{ Expression::Kind::or_, { std::move(left), _parse_and() } };
+		}
+		return left;
+	}
+	Expression _parse_and()
+	{
+		auto left = _parse_comparison();
+		while (_consume("and")) {
+			left = Expression{ Expression::Kind::and_, { std::move(left), _parse_comparison() } };
+		}
+		return left;
+	}
+	Expression _parse_comparison()
+	{
+		constexpr std::pair<std::string_view, Expression::Kind> operators[] = {
+			{ "!=", Expression::Kind::not_equal }, { "<=", Expression::Kind::less_equal },
+			{ ">=", Expression::Kind::greater_equal }, { "=", Expression::Kind::equal },
+			{ "<", Expression::Kind::less }, { ">", Expression::Kind::greater },
+		};
+
+		auto left = _parse_primary();
+		for (const auto& [token, kind] : operators) {
+			if (_consume(token)) {
+				return Expression{ kind, { std::move(left), _parse_primary() } };
+			}
+		}
+		return left;
+	}
+	Expression _parse_primary()
+	{
+		_skip_whitespace();
+		if (_position >= _input.size()) {
+			_fail();
+		}
+
+		const auto c = _input[_position];
+		if (c == '(') {
+			++_position;
+			auto expression = _parse_or();
+			if (!_consume(')')) {
+				_fail();
+			}
+			return expression;
+		} else if (c == '"' || c == '\'') {
+			const auto end = _input.find(c, _position + 1);
+			if (end == std::string_view::npos) {
+				_fail();
+			}
+			Expression literal{ Expression::Kind::literal };
+			literal.literal = _input.substr(_position + 1, end - _position - 1);
+			_position = end + 1;
+			return literal;
+		} else if (c >= '0' && c <= '9') {
+			Expression number{ Expression::Kind::number };
+			const auto [end, error] =
+			  std::from_chars(_input.data() + _position, _input.data() + _input.size(), number.value);
+			if (error != std::errc{}) {
+				_fail();
+			}
+			_position = end - _input.data();
+			number.literal = std::to_string(number.value);
+			return number;
+		} else if (c == '@') {
+			++_position;
+			Expression attribute{ Expression::Kind::attribute };
+			attribute.value = _snapshot._find_name(_parse_name());
+			return attribute;
+		} else if (_consume("text()")) {
+			return Expression{ Expression::Kind::text };
+		} else if (c == '.') {
+			++_position;
+			return Expression{ Expression::Kind::self };
+		}
+
+		const auto name = _parse_name();
+		if (!_consume('(')) {
+			Expression child{ Expression::Kind::child };
+			child.value = _snapshot._find_name(name);
+			return child;
+		}
+		constexpr std::pair<std::string_view, Expression::Kind> functions[] = {
+			{ "not", Expression::Kind::not_ },
+			{ "contains", Expression::Kind::contains },
+			{ "starts-with", Expression::Kind::starts_with },
+			{ "normalize-space", Expression::Kind::normalize_space },
+			{ "position", Expression::Kind::position },
+			{ "last", Expression::Kind::last },
+		};
+		const auto function = std::find_if(std::begin(functions), std::end(functions),
+		                                   [&](const auto& function) { return function.first == name; });
+		if (function == std::end(functions)) {
+			_fail();
+		}
+
+		Expression expression{ function->second };
+		_positional |= expression.kind == Expression::Kind::position || expression.kind == Expression::Kind::last;
+		if (!_consume(')')) {
+			do {
+				expression.operands.push_back(_parse_or());
+			} while (_consume(','));
+			if (!_consume(')')) {
+				_fail();
+			}
+		}
+
+		const auto arguments = expression.operands.size();
+		switch (expression.kind) {
+		case Expression::Kind::not_:
+			if (arguments != 1) {
+				_fail();
+			}
+			break;
+		case Expression::Kind::contains:
+		case Expression::Kind::starts_with:
+			if (arguments != 2) {
+				_fail();
+			}
+			break;
+		case Expression::Kind::normalize_space:
+			if (arguments > 1) {
+				_fail();
+			}
+			break;
+		default:
+			if (arguments != 0) {
+				_fail();
+			}
+			break;
+		}
+		return expression;
+	}
+
+	const DomSnapshot::Node* _node(std::uint32_t node) const noexcept
+	{
+		return node == document ? nullptr : &_snapshot._nodes[node];
+	}
+	std::uint32_t _first_child(std::uint32_t node) const noexcept
+	{
+		if (node == document) {
+			return _snapshot._nodes.empty() ? DomSnapshot::npos : 0;
+		}
+		return _snapshot._nodes[node].first_child;
+	}
+	bool _test(const Step& step, std::uint32_t node) const noexcept
+	{
+		const auto element = _node(node);
+		switch (step.test) {
+		case Test::name: return element && element->type == DomNodeType::element && element->name == step.name;
+		case Test::element: return element && element->type == DomNodeType::element;
+		case Test::text: return element && element->type == DomNodeType::text;
+		case Test::node: return true;
+		}
+		return false;
+	}
+	std::optional<std::string_view> _attribute(std::uint32_t node, std::uint32_t name) const noexcept
+	{
+		if (const auto element = _node(node)) {
+			for (auto i = element->attributes_begin; i < element->attributes_end; ++i) {
+				if (_snapshot._attributes[i].first == name) {
+					return _snapshot._string(_snapshot._attributes[i].second);
+				}
+			}
+		}
+		return std::nullopt;
+	}
+	/// The first child element with the name.
+	std::uint32_t _child(std::uint32_t node, std::uint32_t name) const noexcept
+	{
+		for (auto child = _first_child(node); child != DomSnapshot::npos;
+		     child = _snapshot._nodes[child].next_sibling) {
+			const auto& element = _snapshot._nodes[child];
+			if (element.type == DomNodeType::element && element.name == name) {
+				return child;
+			}
+		}
+		return DomSnapshot::npos;
+	}
+	/// The concatenated direct text children.
+	std::string _text(std::uint32_t node) const
+	{
+		std::string text;
+		for (auto child = _first_child(node); child != DomSnapshot::npos;
+		     child = _snapshot._nodes[child].next_sibling) {
+			if (_snapshot._nodes[child].type == DomNodeType::text) {
+				text += _snapshot._string(_snapshot._nodes[child].name);
+			}
+		}
+		return text;
+	}
+	std::string _string_value(const Expression& expression, std::uint32_t node, std::size_t position,
+	                          std::size_t size) const
+	{
+		switch (expression.kind) {
+		case Expression::Kind::attribute:
+			return std::string{ _attribute(node, expression.value).value_or(std::string_view{}) };
+		case Expression::Kind::text: return _text(node);
+		case Expression::Kind::child: {
+			const auto child = _child(node, expression.value);
+			return child == DomSnapshot::npos ? std::string{} : DomNode{ &_snapshot, child }.get_text();
+		}
+		case Expression::Kind::self:
+			return node == document ? std::string{} : DomNode{ &_snapshot, node }.get_text();
+		case Expression::Kind::literal:
+		case Expression::Kind::number: return expression.literal;
+		case Expression::Kind::position: return std::to_string(position);
+		case Expression::Kind::last: return std::to_string(size);
+		case Expression::Kind::normalize_space: {
+			const auto value = expression.operands.empty()
+			                     ? _string_value(Expression{ Expression::Kind::self }, node, position, size)
+			                     : _string_value(expression.operands.front(), node, position, size);
+			std::string result;
+			for (const auto c : value) {
+				if (!is_css_whitespace(c)) {
+					result += c;
+				} else if (!result.empty() && result.back() != ' ') {
+					result += ' ';
+				}
+			}
+			if (!result.empty() && result.back() == ' ') {
+				result.pop_back();
+			}
+			return result;
+		}
+		default: return _evaluate(expression, node, position, size) ? "true" : "false";
+		}
+	}
+	bool _evaluate(const Expression& expression, std::uint32_t node, std::size_t position,
+	               std::size_t size) const
+	{
+		const auto& operands = expression.operands;
+		switch (expression.kind) {
+		case Expression::Kind::or_:
+			return _evaluate(operands[0], node, position, size) || _evaluate(operands[1], node, position, size);
+		case Expression::Kind::and_:
+			return _evaluate(operands[0], node, position, size) && _evaluate(operands[1], node, position, size);
+		case Expression::Kind::not_: return !_evaluate(operands[0], node, position, size);
+		case Expression::Kind::equal:
+		case Expression::Kind::not_equal: {
+			// A comparison with a missing attribute or child is always false.
+			for (const auto& operand : operands) {
+				if ((operand.kind == Expression::Kind::attribute || operand.kind == Expression::Kind::child) &&
+				    !_evaluate(operand, node, position, size)) {
+					return false;
+				}
+			}
+			const bool equal =
+			  _string_value(operands[0], node, position, size) == _string_value(operands[1], node, position, size);
+			return expression.kind == Expression::Kind::equal ? equal : !equal;
+		}
+		case Expression::Kind::less:
+		case Expression::Kind::less_equal:
+		case Expression::Kind::greater:
+		case Expression::Kind::greater_equal: {
+			const auto number = [&](const Expression& operand) {
+				const auto value = _string_value(operand, node, position, size);
+				char* end = nullptr;
+				const auto result = std::strtod(value.c_str(), &end);
+				return end == value.c_str() ? std::numeric_limits<double>::quiet_NaN() : result;
+			};
+			const auto left = number(operands[0]);
+			const auto right = number(operands[1]);
+			switch (expression.kind) {
+			case Expression::Kind::less: return left < right;
+			case Expression::Kind::less_equal: return left <= right;
+			case Expression::Kind::greater: return left > right;
+			default: return left >= right;
+			}
+		}
+		case Expression::Kind::contains:
+			return _string_value(operands[0], node, position, size)
+			         .find(_string_value(operands[1], node, position, size)) != std::string::npos;
+		case Expression::Kind::starts_with: {
+			const auto value = _string_value(operands[0], node, position, size);
+			const auto prefix = _string_value(operands[1], node, position, size);
+			return value.compare(0, prefix.size(), prefix) == 0;
+		}
+		case Expression::Kind::number: return position == expression.value;
+		case Expression::Kind::position: return position != 0;
+		case Expression::Kind::last: return position == size;
+		case Expression::Kind::attribute: return _attribute(node, expression.value).has_value();
+		case Expression::Kind::child: return _child(node, expression.value) != DomSnapshot::npos;
+		case Expression::Kind::text:
+			for (auto child = _first_child(node); child != DomSnapshot::npos;
+			     child = _snapshot._nodes[child].next_sibling) {
+				if (_snapshot._nodes[child].type == DomNodeType::text) {
+					return true;
+				}
+			}
+			return false;
+		case Expression::Kind::self: return true;
+		default: return !_string_value(expression, node, position, size).empty();
+		}
+	}
+	/// Appends the candidates which pass all predicates.
+	void _filter(const Step& step, std::vector<std::uint32_t>& candidates,
+	             std::vector<std::uint32_t>& result) const
+	{
+		for (const auto& predicate : step.predicates) {
+			std::size_t kept = 0;
+			for (std::size_t i = 0; i < candidates.size(); ++i) {
+				if (_evaluate(predicate, candidates[i], i + 1, candidates.size())) {
+					candidates[kept++] = candidates[i];
+				}
+			}
+			candidates.resize(kept);
+		}
+		result.insert(result.end(), candidates.begin(), candidates.end());
+	}
+	std::vector<std::uint32_t> _evaluate(const Step& step, const std::vector<std::uint32_t>& contexts) const
+	{
+		std::vector<std::uint32_t> result;
+		std::vector<std::uint32_t> candidates;
+		const auto size = static_cast<std::uint32_t>(_snapshot._nodes.size());
+
+		if (step.axis == Axis::descendant && !step.positional) {
+			// The descendants of a node are contiguous, so nested contexts are skipped. The document is sorted last
+			// but contains everything.
+			std::uint32_t covered = 0;
+			for (const auto context : contexts) {
+				if (contexts.back() == document && context != document) {
+					continue;
+				}
+				const auto begin = context == document ? 0 : std::max(context + 1, covered);
+				const auto end = context == document ? size : _snapshot._nodes[context].end;
+				for (auto node = begin; node < end; ++node) {
+					if (_test(step, node)) {
+						candidates.push_back(node);
+					}
+				}
+				covered = std::max(covered, end);
+			}
+			_filter(step, candidates, result);
+			return result;
+		}
+
+		for (const auto context : contexts) {
+			candidates.clear();
+			switch (step.axis) {
+			case Axis::child:
+				for (auto child = _first_child(context); child != DomSnapshot::npos;
+				     child = _snapshot._nodes[child].next_sibling) {
+					if (_test(step, child)) {
+						candidates.push_back(child);
+					}
+				}
+				break;
+			case Axis::descendant:
+			case Axis::descendant_or_self: {
+				if (step.axis == Axis::descendant_or_self && _test(step, context)) {
+					candidates.push_back(context);
+				}
+				const auto begin = context == document ? 0 : context + 1;
+				const auto end = context == document ? size : _snapshot._nodes[context].end;
+				for (auto node = begin; node < end; ++node) {
+					if (_test(step, node)) {
+						candidates.push_back(node);
+					}
+				}
+				break;
+			}
+			case Axis::self:
+				if (_test(step, context)) {
+					candidates.push_back(context);
+				}
+				break;
+			case Axis::parent:
+				if (context != document) {
+					const auto parent = _snapshot._nodes[context].parent;
+					candidates.push_back(parent == DomSnapshot::npos ? document : parent);
+				}
+				break;
+			}
+			_filter(step, candidates, result);
+		}
+
+		std::sort(result.begin(), result.end());
+		result.erase(std::unique(result.begin(), result.end()), result.end());
+		return result;
+	}
+};
+
+} // namespace detail
+
+inline std::uint32_t DomNode::get_index() const noexcept { return _index; }
+
+inline DomNodeType DomNode::get_type() const noexcept { return _snapshot->_nodes[_index].type; }
+
+inline bool DomNode::is_element() const noexcept { return get_type() == DomNodeType::element; }
+
+inline std::string_view DomNode::get_tag_name() const noexcept
+{
+	return is_element() ? _snapshot->_string(_snapshot->_nodes[_index].name) : std::string_view{};
+}
+
+inline std::optional<std::string_view> DomNode::get_attribute(std::string_view name) const noexcept
+{
+	const auto& node = _snapshot->_nodes[_index];
+	for (auto i = node.attributes_begin; i < node.attributes_end; ++i) {
+		if (_snapshot->_string(_snapshot->_attributes[i].first) == name) {
+			return _snapshot->_string(_snapshot->_attributes[i].second);
+		}
+	}
+	return std::nullopt;
+}
+
+inline std::vector<std::pair<std::string_view, std::string_view>> DomNode::get_attributes() const
+{
+	const auto& node = _snapshot->_nodes[_index];
+	std::vector<std::pair<std::string_view, std::string_view>> attributes;
+	attributes.reserve(node.attributes_end - node.attributes_begin);
+	for (auto i = node.attributes_begin; i < node.attributes_end; ++i) {
+		attributes.emplace_back(_snapshot->_string(_snapshot->_attributes[i].first),
+		                        _snapshot->_string(_snapshot->_attributes[i].second));
+	}
+	return attributes;
+}
+
+inline std::string DomNode::get_text() const
+{
+	const auto& nodes = _snapshot->_nodes;
+	std::size_t size = 0;
+	for (auto i = _index; i < nodes[_index].end; ++i) {
+		if (nodes[i].type == DomNodeType::text) {
+			size += _snapshot->_strings[nodes[i].name].second;
+		}
+	}
+	std::string text;
+	text.reserve(size);
+	for (auto i = _index; i < nodes[_index].end; ++i) {
+		if (nodes[i].type == DomNodeType::text) {
+			text += _snapshot->_string(nodes[i].name);
+		}
+	}
+	return text;
+}
+
+inline bool DomNode::is_visible() const noexcept { return _snapshot->_nodes[_index].visible; }
+
+inline std::optional<DomNode> DomNode::get_parent() const noexcept
+{
+	const auto index = _snapshot->_nodes[_index].parent;
+	return index == DomSnapshot::npos ? std::nullopt : std::make_optional(DomNode{ _snapshot, index });
+}
+
+inline std::optional<DomNode> DomNode::get_first_child() const noexcept
+{
+	const auto index = _snapshot->_nodes[_index].first_child;
+	return index == DomSnapshot::npos ? std::nullopt : std::make_optional(DomNode{ _snapshot, index });
+}
+
+inline std::optional<DomNode> DomNode::get_next_sibling() const noexcept
+{
+	const auto index = _snapshot->_nodes[_index].next_sibling;
+	return index == DomSnapshot::npos ? std::nullopt : std::make_optional(DomNode{ _snapshot, index });
+}
+
+inline std::optional<DomNode> DomNode::get_previous_sibling() const noexcept
+{
+	const auto index = _snapshot->_nodes[_index].previous_sibling;
+	return index == DomSnapshot::npos ? std::nullopt : std::make_optional(DomNode{ _snapshot, index });
+}
+
+inline std::size_t DomNode::get_descendant_count() const noexcept
+{
+	return _snapshot->_nodes[_index].end - _index - 1;
+}
+
+inline std::vector<DomNode> DomNode::select(std::string_view selector) const
+{
+	return _snapshot->_select(selector, _index + 1, _snapshot->_nodes[_index].end, false);
+}
+
+inline std::optional<DomNode> DomNode::select_first(std::string_view selector) const
+{
+	const auto nodes = _snapshot->_select(selector, _index + 1, _snapshot->_nodes[_index].end, true);
+	return nodes.empty() ? std::nullopt : std::make_optional(nodes.front());
+}
+
+inline std::vector<DomNode> DomNode::select_xpath(std::string_view xpath) const
+{
+	return _snapshot->_select_xpath(xpath, _index);
+}
+
+inline bool DomSnapshot::empty() const noexcept { return _nodes.empty(); }
+
+inline std::size_t DomSnapshot::size() const noexcept { return _nodes.size(); }
+
+inline DomNode DomSnapshot::get_root() const noexcept { return DomNode{ this, 0 }; }
+
+inline DomNode DomSnapshot::operator[](std::uint32_t index) const noexcept { return DomNode{ this, index }; }
+
+inline std::vector<DomNode> DomSnapshot::select(std::string_view selector) const
+{
+	return _select(selector, 0, static_cast<std::uint32_t>(_nodes.size()), false);
+}
+
+inline std::optional<DomNode> DomSnapshot::select_first(std::string_view selector) const
+{
+	const auto nodes = _select(selector, 0, static_cast<std::uint32_t>(_nodes.size()), true);
+	return nodes.empty() ? std::nullopt : std::make_optional(nodes.front());
+}
+
+inline std::vector<DomNode> DomSnapshot::select_xpath(std::string_view xpath) const
+{
+	return _select_xpath(xpath, detail::XPathEngine::document);
+}
+
+inline DomSnapshot DomSnapshot::decode(std::string strings, std::string_view nodes)
+{
+	DomSnapshot snapshot{};
+	snapshot._buffer = std::move(strings);
+
+	const auto& buffer = snapshot._buffer;
+	snapshot._strings.reserve(std::count(buffer.begin(), buffer.end(), '\0') + 1);
+	for (std::size_t begin = 0;;) {
+		const auto end = std::min(buffer.find('\0', begin), buffer.size());
+		snapshot._strings.emplace_back(static_cast<std::uint32_t>(begin),
+		                               static_cast<std::uint32_t>(end - begin));
+		if (end == buffer.size()) {
+			break;
+		}
+		begin = end + 1;
+	}
+
+	std::size_t position = 0;
+	const auto next = [&] {
+		std::uint32_t value = 0;
+		const auto [end, error] = std::from_chars(nodes.data() + position, nodes.data() + nodes.size(), value);
+		if (error != std::errc{} || (end != nodes.data() + nodes.size() && *end != ',')) {
+			throw std::invalid_argument{ "malformed DOM snapshot" };
+		}
+		position = end - nodes.data() + 1;
+		return value;
+	};
+	const auto string = [&] {
+		const auto index = next();
+		if (index >= snapshot._strings.size()) {
+			throw std::invalid_argument{ "malformed DOM snapshot" };
+		}
+		return index;
+	};
+
+	// The names are interned in the string table, so each one is added to `_names` only once.
+	std::vector<bool> named(snapshot._strings.size());
+	const auto add_name = [&](std::uint32_t index) {
+		if (!named[index]) {
+			named[index] = true;
+			snapshot._names.emplace(snapshot._string(index), index);
+		}
+	};
+
+	struct Frame {
+		std::uint32_t node;
+		std::uint32_t remaining;
+		std::uint32_t last_child;
+	};
+	std::vector<Frame> stack;
+	// Every node takes at least two numbers.
+	snapshot._nodes.reserve(std::count(nodes.begin(), nodes.end(), ',') / 4 + 1);
+
+	while (position < nodes.size()) {
+		const auto index = static_cast<std::uint32_t>(snapshot._nodes.size());
+		Node node{};
+		if (!stack.empty()) {
+			auto& frame = stack.back();
+			node.parent = frame.node;
+			node.previous_sibling = frame.last_child;
+			if (frame.last_child == npos) {
+				snapshot._nodes[frame.node].first_child = index;
+			} else {
+				snapshot._nodes[frame.last_child].next_sibling = index;
+			}
+			frame.last_child = index;
+			--frame.remaining;
+		} else if (index != 0) {
+			throw std::invalid_argument{ "malformed DOM snapshot" };
+		}
+
+		std::uint32_t children = 0;
+		switch (next()) {
+		case 1: {
+			node.name = string();
+			add_name(node.name);
+			const auto attributes = next();
+			node.attributes_begin = static_cast<std::uint32_t>(snapshot._attributes.size());
+			for (std::uint32_t i = 0; i < attributes; ++i) {
+				const auto name = string();
+				snapshot._attributes.emplace_back(name, string());
+				add_name(name);
+			}
+			node.attributes_end = static_cast<std::uint32_t>(snapshot._attributes.size());
+			node.visible = next() != 0;
+			children = next();
+			if (node.parent != npos) {
+				node.element_position = ++snapshot._nodes[node.parent].element_children;
+			}
+			break;
+		}
+		case 3:
+			node.type = DomNodeType::text;
+			node.name = string();
+			break;
+		default: throw std::invalid_argument{ "malformed DOM snapshot" };
+		}
+
+		node.end = index + 1;
+		snapshot._nodes.push_back(node);
+		if (children > 0) {
+			stack.push_back(Frame{ index, children, npos });
+		}
+		while (!stack.empty() && stack.back().remaining == 0) {
+			snapshot._nodes[stack.back().node].end = static_cast<std::uint32_t>(snapshot._nodes.size());
+			stack.pop_back();
+		}
+	}
+	if (!stack.empty()) {
+		throw std::invalid_argument{ "truncated DOM snapshot" };
+	}
+	return snapshot;
+}
+
+inline std::string_view DomSnapshot::_string(std::uint32_t index) const noexcept
+{
+	const auto [offset, size] = _strings[index];
+	return std::string_view{ _buffer }.substr(offset, size);
+}
+
+inline std::uint32_t DomSnapshot::_find_name(std::string_view name) const
+{
+	const auto it = _names.find(std::string{ name });
+	return it == _names.end() ? npos : it->second;
+}
+
+inline std::vector<DomNode> DomSnapshot::_select(std::string_view selector, std::uint32_t begin,
+                                                 std::uint32_t end, bool first) const
+{
+	const detail::CssEngine engine{ *this, selector };
+	std::vector<DomNode> nodes;
+	for (auto i = begin; i < end; ++i) {
+		if (engine.matches(i)) {
+			nodes.push_back(DomNode{ this, i });
+			if (first) {
+				break;
+			}
+		}
+	}
+	return nodes;
+}
+
+inline std::vector<DomNode> DomSnapshot::_select_xpath(std::string_view xpath, std::uint32_t context) const
+{
+	return detail::XPathEngine{ *this, xpath }.evaluate(context);
+}
+
+} // namespace wdlite
@@ -4,9 +4,17 @@
 
 #include <optional>
 #include <sstream>
+#include <type_traits>
 
 namespace wdlite {
 
+namespace detail {
+
+/// The key identifying a web element reference in JSON payloads.
+constexpr std::string_view web_element_identifier = "element-6066-11e4-a52e-4f735466cecf";
+
+} // namespace detail
+
 class Element {
 public:
 	using executor_type = Session::executor_type;
@@ -44,16 +52,30 @@ private:
 	std::shared_ptr<Session> _session;
 	std::string _id;
 	std::string _prefix;
+	detail::ElementTracker _tracker;
 
 	Element(std::shared_ptr<Session> session, std::string id);
 };
 
+/// Serializes the element as web element reference. This allows passing elements as arguments to scripts.
+inline void to_json(nlohmann::json& json, const Element& value)
+{
+	json = nlohmann::json{ { detail::web_element_identifier, value.get_id() } };
+}
+
 template<typename... Values>
 inline std::string make_keys(Values&&... values)
 {
-	std::stringstream stream{};
-	(stream << ... << std::forward<Values>(values));
-	return std::move(stream).str();
+	if constexpr ((std::is_convertible_v<const Values&, std::string_view> && ...)) {
+		std::string result{};
+		result.reserve((std::string_view{ values }.size() + ... + 0));
+		(result.append(std::string_view{ values }), ...);
+		return result;
+	} else {
+		std::stringstream stream{};
+		(stream << ... << std::forward<Values>(values));
+		return std::move(stream).str();
+	}
 }
 
 } // namespace wdlite
@@ -85,7 +85,7 @@ inline auto Element::async_take_screenshot(Token&& token) const
 }
 
 inline Element::Element(std::shared_ptr<Session> session, std::string id)
-    : _session{ std::move(session) }, _id{ std::move(id) }
+    : _session{ std::move(session) }, _id{ std::move(id) }, _tracker{ _session->_counters }
 {
 	_prefix = "session/" + _session->_session_id + "/element/" + _id;
 }
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "fwd.hpp"
+#include "limiter.hpp"
+#include "tape.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace wdlite {
+
+/**
+ * A remote WebDriver endpoint. All sessions created on the same instance share it, so it is the place for
+ * settings which concern the transport rather than a single session.
+ *
+ * ```cpp
+ * auto endpoint = std::make_shared<wdlite::Endpoint>("http://localhost:9515");
+ * endpoint->set_replayer(std::make_shared<wdlite::Replayer>("login.tape", 0));
+ * auto session = co_await wdlite::async_new_session(executor, endpoint, capabilities, asio::use_awaitable);
+ * ```
+ */
+class Endpoint {
+public:
+	/// @param url The WebDriver endpoint URL. For example: `http://localhost:9515`.
+	explicit Endpoint(std::string url) : _url{ std::move(url) }
+	{
+		if (!_url.empty() && _url.back() != '/') {
+			_url.push_back('/');
+		}
+	}
+
+	/// The URL with a trailing slash.
+	const std::string& get_url() const noexcept { return _url; }
+	/// Records every exchange of the sessions on this endpoint. Must be set before the sessions are created.
+	void set_recorder(std::shared_ptr<Recorder> recorder) noexcept { _recorder = std::move(recorder); }
+	const std::shared_ptr<Recorder>& get_recorder() const noexcept { return _recorder; }
+	/**
+	 * Answers all commands from a recorded tape instead of sending them to the URL. Must be set before the
+	 * sessions are created.
+	 */
+	void set_replayer(std::shared_ptr<Replayer> replayer) noexcept { _replayer = std::move(replayer); }
+	const std::shared_ptr<Replayer>& get_replayer() const noexcept { return _replayer; }
+	/**
+	 * Limits the requests in flight across all sessions on this endpoint. Without a limiter, requests are only
+	 * limited per session. Must be set before the sessions are created.
+	 */
+	void set_limiter(std::shared_ptr<Limiter> limiter) noexcept { _limiter = std::move(limiter); }
+	const std::shared_ptr<Limiter>& get_limiter() const noexcept { return _limiter; }
+
+	/// The number of `Session` instances on this endpoint.
+	std::size_t get_session_count() const noexcept { return _sessions.load(std::memory_order_relaxed); }
+	/// The smoothed latency of the recent responses or zero if nothing was received yet.
+	std::chrono::steady_clock::duration get_latency() const noexcept
+	{
+		return std::chrono::steady_clock::duration{ _latency.load(std::memory_order_relaxed) };
+	}
+	/// Updates the smoothed latency. Called for every response received from this endpoint.
+	void report_latency(std::chrono::steady_clock::duration latency) noexcept
+	{
+		// Concurrent updates may get lost which is fine for an estimate.
+		const auto previous = _latency.load(std::memory_order_relaxed);
+		const auto sample = static_cast<std::int64_t>(latency.count());
+		_latency.store(previous == 0 ? sample : previous + (sample - previous) / 8, std::memory_order_relaxed);
+	}
+	/// Whether the endpoint accepts new sessions. Endpoints are healthy until a health check fails. See
+	/// `EndpointPool`.
+	bool is_healthy() const noexcept { return _healthy.load(std::memory_order_relaxed); }
+	void set_healthy(bool healthy) noexcept { _healthy.store(healthy, std::memory_order_relaxed); }
+
+private:
+	friend Session;
+
+	std::string _url;
+	std::shared_ptr<Recorder> _recorder;
+	std::shared_ptr<Replayer> _replayer;
+	std::shared_ptr<Limiter> _limiter;
+	std::atomic<std::size_t> _sessions{ 0 };
+	std::atomic<std::int64_t> _latency{ 0 };
+	std::atomic<bool> _healthy{ true };
+};
+
+} // namespace wdlite
@@ -39,6 +39,16 @@ enum class Code {
 	unknown_error,
 	unknown_method,
 	unsupported_operation,
+
+	/// A replayed command was not found on the tape. See `Replayer`.
+	no_recorded_response = 100,
+	/// None of the endpoints of an `EndpointPool` is healthy.
+	no_healthy_endpoint,
+	/// The response exceeded the maximum response size and its transfer was aborted. See
+	/// `Session::set_max_response_size()`.
+	response_too_large,
+	/// The response is not valid JSON.
+	invalid_response,
 };
 
 enum class Condition {
@@ -167,6 +177,11 @@ enum class Condition {
 				return "Indicates that a command that should have executed properly cannot be supported for some "
 				       "reason.";
 
+			case Code::no_recorded_response: return "The command was not recorded on the replayed tape.";
+			case Code::no_healthy_endpoint: return "No healthy endpoint is available for a new session.";
+			case Code::response_too_large: return "The response exceeded the maximum response size.";
+			case Code::invalid_response: return "The response is not valid JSON.";
+
 			default: return "(unrecognized error code)";
 			}
 		}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <nlohmann/json.hpp>
+#include <string>
+
+namespace wdlite {
+
+/// Options for `Session::async_navigate_and_extract()`.
+struct ExtractOptions {
+	using duration = std::chrono::steady_clock::duration;
+
+	enum class Readiness {
+		/// The document is loaded as defined by the page load strategy of the session.
+		load,
+		/// No more than `max_in_flight` requests were running for `quiet_period`. See
+		/// `Session::async_wait_for_network_idle()`.
+		network_idle,
+		/// Neither the DOM nor the document size changed for `quiet_period`. See
+		/// `Session::async_wait_for_render_stable()`.
+		render_stable,
+		/// The function body `condition` returned a truthy value or a promise resolving to one.
+		condition,
+	};
+
+	Readiness readiness = Readiness::load;
+	/// Polled every 50 ms with `Readiness::condition`.
+	std::string condition;
+	duration quiet_period = std::chrono::milliseconds{ 500 };
+	std::size_t max_in_flight = 0;
+	/// Extracts anyway after this time. Must stay below the script timeout of the session.
+	duration deadline = std::chrono::seconds{ 10 };
+};
+
+/// Where the time of `Session::async_navigate_and_extract()` went.
+struct NavigationTimings {
+	using duration = std::chrono::steady_clock::duration;
+
+	/// The navigation command as seen by the client.
+	duration navigation{};
+	/// From the start of the navigation until the first response byte as reported by the browser.
+	duration response_start{};
+	/// From the start of the navigation until the end of `DOMContentLoaded` as reported by the browser.
+	duration dom_content_loaded{};
+	/// From the start of the navigation until the end of the `load` event as reported by the browser. Zero if
+	/// the page did not finish loading.
+	duration load{};
+	/// Waiting for the readiness condition in the browser.
+	duration ready_wait{};
+	/// Running the extraction script in the browser.
+	duration extraction{};
+	/// The whole operation as seen by the client.
+	duration total{};
+};
+
+/// The result of `Session::async_navigate_and_extract()`.
+struct ExtractResult {
+	/// The value returned by the extraction script.
+	nlohmann::json value;
+	/// Whether the readiness condition was met before the deadline.
+	bool ready = false;
+	NavigationTimings timings;
+};
+
+namespace detail {
+
+/// Converts milliseconds reported by the browser.
+inline std::chrono::steady_clock::duration from_browser_time(const nlohmann::json& milliseconds)
+{
+	if (!milliseconds.is_number() || milliseconds.get<double>() <= 0) {
+		return {};
+	}
+	return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+	  std::chrono::duration<double, std::milli>{ milliseconds.get<double>() });
+}
+
+} // namespace detail
+
+} // namespace wdlite
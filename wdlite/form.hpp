@@ -0,0 +1,94 @@
+#pragma once
+
+#include "locator.hpp"
+
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace wdlite {
+
+/// An entry of `Session::async_fill_form()`.
+struct FormAction {
+	enum class Kind {
+		/// Sets the value of an input, textarea, select or editable element by script and dispatches `input` and
+		/// `change` events like a user would.
+		set_value,
+		/// Checks a checkbox or radio button by script like a click would.
+		check,
+		/// Unchecks a checkbox or radio button by script like a click would.
+		uncheck,
+		/// Clears the element by script and types the value with native key events. For fields which only accept
+		/// trusted input.
+		type,
+		/// Clicks the element natively.
+		click,
+	};
+
+	/// Must not enter frames.
+	Locator locator;
+	Kind kind = Kind::set_value;
+	/// The value of `Kind::set_value` and `Kind::type`.
+	std::string value;
+};
+
+namespace detail {
+
+/**
+ * Performs the entries `arguments[0]` of `[steps, kind, value, context]` in order. Returns one item per
+ * entry: `0` if it was done, `1` if the element was not found, `2` if the element cannot take the action and
+ * the element itself for the native kinds. Stops with `3` at an entry whose element can only be found with
+ * native commands.
+ */
+constexpr std::string_view fill_form_script =
+  R"(const o=[];const R=(s,n)=>{n=n||document;for(const[k,v]of s){)"
+  R"(if(k==='s'){if(!n.shadowRoot)return 3;n=n.shadowRoot;}else if(k==='c')n=n.querySelector(v);)"
+  R"(else if(k==='x')n=document.evaluate(v,n,null,9,null).singleNodeValue;else return 3;)"
+  R"(if(!n)return 1;}return n;};)"
+  R"(const P=n=>[HTMLInputElement,HTMLTextAreaElement,HTMLSelectElement].find(t=>n instanceof t);)"
+  R"(const F=(n,e)=>n.dispatchEvent(new Event(e,{bubbles:true}));)"
+  R"(const V=(n,v)=>{const t=P(n);if(t){if(n.disabled||n.readOnly)return 2;)"
+  R"(Object.getOwnPropertyDescriptor(t.prototype,'value').set.call(n,v);})"
+  R"(else if(n.isContentEditable)n.textContent=v;else return 2;F(n,'input');F(n,'change');return 0;};)"
+  R"(for(const[s,k,v,c]of arguments[0]){const n=R(s,c);)"
+  R"(if(typeof n==='number'){o.push(n);if(n===3)break;continue;})"
+  R"(if(k==='v')o.push(V(n,v));else if(k==='k'||k==='u'){const w=k==='k';)"
+  R"(if(!(n instanceof HTMLInputElement)||n.disabled)o.push(2);else{if(n.checked!==w)n.click();)"
+  R"(if(n.checked!==w){n.checked=w;F(n,'input');F(n,'change');}o.push(0);}})"
+  R"(else{if(k==='t'&&P(n)&&n.value!=='')V(n,'');o.push(n);}})"
+  R"(return o;)";
+
+inline bool is_native(FormAction::Kind kind) noexcept
+{
+	return kind == FormAction::Kind::type || kind == FormAction::Kind::click;
+}
+
+inline std::string_view to_script_kind(FormAction::Kind kind) noexcept
+{
+	switch (kind) {
+	case FormAction::Kind::check: return "k";
+	case FormAction::Kind::uncheck: return "u";
+	case FormAction::Kind::type: return "t";
+	case FormAction::Kind::click: return "c";
+	default: return "v";
+	}
+}
+
+/// Throws `std::invalid_argument` if the locator cannot be used by `Session::async_fill_form()`.
+inline void check_form_locator(const Locator& locator)
+{
+	const auto& steps = locator.get_steps();
+	if (steps.empty() || steps.back().kind != Locator::Step::Kind::find) {
+		throw std::invalid_argument{ "a form action must locate an element" };
+	}
+	for (const auto& step : steps) {
+		if (step.kind == Locator::Step::Kind::frame) {
+			throw std::invalid_argument{ "a form action must not enter frames" };
+		}
+	}
+}
+
+} // namespace detail
+
+} // namespace wdlite
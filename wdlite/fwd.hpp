@@ -2,7 +2,18 @@
 
 namespace wdlite {
 
+class Actions;
+struct Cookie;
+class DomNode;
+class DomSnapshot;
 class Element;
+class Endpoint;
+class EndpointPool;
+struct FormAction;
+class Locator;
+class PreparedScript;
 class Session;
+struct SessionState;
+class WindowMultiplexer;
 
 } // namespace wdlite
@@ -1,7 +1,28 @@
 #pragma once
 
+#include <cstddef>
+#include <stdexcept>
 #include <string_view>
 
+namespace wdlite::detail {
+
+/// Returns the length of the UTF-8 sequence starting with `lead` or `0` if it is not a valid lead byte.
+constexpr std::size_t utf8_sequence_length(unsigned char lead) noexcept
+{
+	if (lead < 0x80) {
+		return 1;
+	} else if ((lead & 0xe0) == 0xc0) {
+		return 2;
+	} else if ((lead & 0xf0) == 0xe0) {
+		return 3;
+	} else if ((lead & 0xf8) == 0xf0) {
+		return 4;
+	}
+	return 0;
+}
+
+} // namespace wdlite::detail
+
 namespace wdlite::key {
 
 constexpr std::string_view null = "\uE000";
@@ -68,4 +89,61 @@ constexpr std::string_view f12 = "\uE03C";
 constexpr std::string_view command = "\uE03D";
 constexpr std::string_view meta = "\uE03D";
 
+/// A key combination like `Ctrl+Shift+A` which is composed at compile time. Use `chord()` to create one.
+class Chord {
+public:
+	/// The maximum number of keys which can be pressed at once.
+	constexpr static std::size_t max_keys = 8;
+
+	/// The pressed keys in order without the terminating `key::null`.
+	constexpr std::string_view keys() const noexcept { return { _data, _size - null.size() }; }
+	/// The number of keys in this chord.
+	constexpr std::size_t size() const noexcept { return _count; }
+	/// The chord as input for `Element::async_send_keys()`. The modifiers are released by a trailing
+	/// `key::null`.
+	constexpr operator std::string_view() const noexcept { return { _data, _size }; }
+
+private:
+	template<typename... Keys>
+	friend constexpr Chord chord(const Keys&... keys);
+
+	char _data[max_keys * 4 + 3]{};
+	std::size_t _size = 0;
+	std::size_t _count = 0;
+
+	constexpr Chord() noexcept = default;
+	constexpr void _append(std::string_view key)
+	{
+		if (key.empty() || detail::utf8_sequence_length(static_cast<unsigned char>(key.front())) != key.size()) {
+			throw std::invalid_argument{ "every key of a chord must be a single code point" };
+		}
+		for (const auto c : key) {
+			_data[_size++] = c;
+		}
+	}
+};
+
+/**
+ * Composes a chord of keys which are pressed in the given order and released in the reverse order.
+ *
+ * ```cpp
+ * constexpr auto select_all = wdlite::key::chord(wdlite::key::control, "a");
+ * ```
+ *
+ * @param keys Every key must be exactly one code point like `key::shift` or `"a"`.
+ */
+template<typename... Keys>
+constexpr Chord chord(const Keys&... keys)
+{
+	static_assert(sizeof...(Keys) > 0 && sizeof...(Keys) <= Chord::max_keys, "invalid number of chord keys");
+
+	Chord result{};
+	(result._append(std::string_view{ keys }), ...);
+	result._count = sizeof...(Keys);
+	for (const auto c : null) {
+		result._data[result._size++] = c;
+	}
+	return result;
+}
+
 } // namespace wdlite::key
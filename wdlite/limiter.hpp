@@ -0,0 +1,238 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <curlio/curlio.hpp>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace wdlite {
+
+/// Statistics of a `Limiter`.
+struct LimiterStatistics {
+	using duration = std::chrono::steady_clock::duration;
+
+	/// The current number of requests which may be in flight at once.
+	std::size_t limit = 0;
+	std::size_t in_flight = 0;
+	std::size_t waiting = 0;
+	/// The number of requests which were started.
+	std::size_t requests = 0;
+	/// The number of requests which had to wait before they were started.
+	std::size_t delayed_requests = 0;
+	/// The accumulated time requests waited for a slot.
+	duration total_wait{};
+	/// The longest time a single request waited for a slot.
+	duration max_wait{};
+	/// The smoothed latency of the recent requests.
+	duration latency{};
+	/// The long-term average latency the recent latency is compared with.
+	duration baseline_latency{};
+	/// The number of requests which failed on the transport level.
+	std::size_t failures = 0;
+	/// How often the limit was decreased because of congestion.
+	std::size_t decreases = 0;
+};
+
+/**
+ * Limits the number of requests in flight on an endpoint across all of its sessions. Attach it with
+ * `Endpoint::set_limiter()`. Thread-safe, so sessions on different executors may share it.
+ *
+ * The limit adapts to the remote end like TCP congestion control: it grows by one for every limit's worth of
+ * successful requests while it is fully used and shrinks by `Options::decrease_factor`, at most once per
+ * latency, if a request fails on the transport level or if the recent latency exceeds the long-term average
+ * by `Options::latency_tolerance` while the limit is fully used. Waiting requests are started in FIFO order.
+ */
+class Limiter {
+public:
+	using clock = std::chrono::steady_clock;
+
+	struct Options {
+		std::size_t initial_limit = 8;
+		std::size_t min_limit = 1;
+		std::size_t max_limit = 64;
+		/// The limit is multiplied with this factor on congestion.
+		double decrease_factor = 0.7;
+		/// Congestion is assumed once the recent latency exceeds the long-term average by this factor.
+		double latency_tolerance = 2;
+	};
+
+	struct Waiter {
+		clock::time_point enqueued;
+		/// Expires through its executor once the request may start.
+		CURLIO_ASIO_NS::steady_timer timer;
+		bool granted = false;
+	};
+
+	Limiter() : Limiter{ Options{} } {}
+	explicit Limiter(Options options) : _options{ options }
+	{
+		_options.min_limit = std::max<std::size_t>(_options.min_limit, 1);
+		_options.max_limit = std::max(_options.max_limit, _options.min_limit);
+		_limit = static_cast<double>(std::clamp(_options.initial_limit, _options.min_limit, _options.max_limit));
+	}
+	Limiter(const Limiter& copy) = delete;
+
+	LimiterStatistics get_statistics() const
+	{
+		std::lock_guard<std::mutex> lock{ _mutex };
+		auto statistics = _statistics;
+		statistics.limit = _get_limit();
+		statistics.in_flight = _in_flight;
+		statistics.waiting = _waiters.size();
+		statistics.latency = _latency;
+		statistics.baseline_latency = _baseline;
+		return statistics;
+	}
+
+	/// Acquires a slot if nothing is waiting and the limit is not reached.
+	bool try_acquire()
+	{
+		std::lock_guard<std::mutex> lock{ _mutex };
+		if (!_waiters.empty() || _in_flight >= _get_limit()) {
+			return false;
+		}
+		_start(clock::duration{});
+		return true;
+	}
+	/// Queues the request. Wait on the timer of the returned waiter until it was granted.
+	template<typename Executor>
+	std::shared_ptr<Waiter> enqueue(const Executor& executor)
+	{
+		auto waiter = std::make_shared<Waiter>(
+		  Waiter{ clock::now(),
+		          CURLIO_ASIO_NS::steady_timer{ executor, CURLIO_ASIO_NS::steady_timer::time_point::max() } });
+		{
+			std::lock_guard<std::mutex> lock{ _mutex };
+			_waiters.push_back(waiter);
+		}
+		_wake(_dispatch());
+		return waiter;
+	}
+	/// Removes a waiter which was woken up without being granted.
+	void cancel(const std::shared_ptr<Waiter>& waiter)
+	{
+		std::vector<std::shared_ptr<Waiter>> granted;
+		{
+			std::lock_guard<std::mutex> lock{ _mutex };
+			_waiters.erase(std::remove(_waiters.begin(), _waiters.end(), waiter), _waiters.end());
+			if (waiter->granted && _in_flight > 0) {
+				--_in_flight;
+			}
+			granted = _dispatch_locked();
+		}
+		_wake(std::move(granted));
+	}
+	/**
+	 * Must be called exactly once for every started request.
+	 *
+	 * @param latency The time from the start of the request until the response was received.
+	 * @param failed Whether the request failed on the transport level.
+	 */
+	void release(clock::duration latency, bool failed)
+	{
+		std::vector<std::shared_ptr<Waiter>> granted;
+		{
+			std::lock_guard<std::mutex> lock{ _mutex };
+			const auto saturated = _in_flight >= _get_limit();
+			if (_in_flight > 0) {
+				--_in_flight;
+			}
+			_adapt(latency, failed, saturated);
+			granted = _dispatch_locked();
+		}
+		_wake(std::move(granted));
+	}
+
+	Limiter& operator=(const Limiter& copy) = delete;
+
+private:
+	Options _options;
+	mutable std::mutex _mutex;
+	/// Fractional to allow the additive increase of one per limit's worth of requests.
+	double _limit;
+	std::size_t _in_flight = 0;
+	std::deque<std::shared_ptr<Waiter>> _waiters;
+	std::size_t _samples = 0;
+	clock::duration _latency{};
+	clock::duration _baseline{};
+	/// No further decrease before this time so that one congestion event shrinks the limit only once.
+	clock::time_point _hold_until{};
+	LimiterStatistics _statistics;
+
+	std::size_t _get_limit() const noexcept { return static_cast<std::size_t>(_limit); }
+	void _start(clock::duration wait) noexcept
+	{
+		++_in_flight;
+		++_statistics.requests;
+		if (wait > clock::duration{}) {
+			++_statistics.delayed_requests;
+			_statistics.total_wait += wait;
+			_statistics.max_wait = std::max(_statistics.max_wait, wait);
+		}
+	}
+	void _adapt(clock::duration latency, bool failed, bool saturated) noexcept
+	{
+		// Exponentially weighted like the TCP round-trip time estimation. The slow average absorbs the mix of
+		// cheap and expensive commands, so only a sudden slowdown counts as congestion.
+		if (_samples++ == 0) {
+			_latency = latency;
+			_baseline = latency;
+		} else {
+			_latency += (latency - _latency) / 8;
+			_baseline += (latency - _baseline) / 64;
+		}
+		// The averages need some samples to settle.
+		const auto slow = _samples > 32 && _latency > _baseline * _options.latency_tolerance;
+
+		if (failed) {
+			++_statistics.failures;
+		}
+		const auto now = clock::now();
+		if (failed || (saturated && slow)) {
+			if (now >= _hold_until) {
+				_limit = std::max(_limit * _options.decrease_factor, static_cast<double>(_options.min_limit));
+				_hold_until = now + _latency;
+				++_statistics.decreases;
+			}
+		} else if (saturated) {
+			_limit = std::min(_limit + 1 / _limit, static_cast<double>(_options.max_limit));
+		}
+	}
+	std::vector<std::shared_ptr<Waiter>> _dispatch()
+	{
+		std::lock_guard<std::mutex> lock{ _mutex };
+		return _dispatch_locked();
+	}
+	std::vector<std::shared_ptr<Waiter>> _dispatch_locked()
+	{
+		std::vector<std::shared_ptr<Waiter>> granted;
+		const auto now = clock::now();
+		while (!_waiters.empty() && _in_flight < _get_limit()) {
+			auto waiter = std::move(_waiters.front());
+			_waiters.pop_front();
+			_start(now - waiter->enqueued);
+			waiter->granted = true;
+			granted.push_back(std::move(waiter));
+		}
+		return granted;
+	}
+	/**
+	 * The timers are touched on their own executors because they may belong to other threads. Unlike
+	 * cancelling, letting them expire also completes a wait which starts after this.
+	 */
+	static void _wake(std::vector<std::shared_ptr<Waiter>> granted)
+	{
+		for (auto& waiter : granted) {
+			auto executor = waiter->timer.get_executor();
+			CURLIO_ASIO_NS::post(executor, [waiter = std::move(waiter)] {
+				waiter->timer.expires_at(CURLIO_ASIO_NS::steady_timer::time_point::min());
+			});
+		}
+	}
+};
+
+} // namespace wdlite
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "element.hpp"
+
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace wdlite {
+
+namespace detail {
+
+/// The key identifying a shadow root reference in JSON payloads.
+constexpr std::string_view shadow_root_identifier = "shadow-6066-11e4-a52e-4f735466cecf";
+
+/**
+ * Resolves the steps `arguments[0]` starting at `arguments[1]` or the document. Returns the found element,
+ * `null` if a step found nothing, or `[index, context]` if step `index` has to be performed with a native
+ * command, e.g. because of a closed shadow root.
+ */
+constexpr std::string_view resolve_locator_script = R"(const s=arguments[0];let n=arguments[1]||document;
+for(let i=0;i<s.length;++i){const[k,v]=s[i];
+if(k==='s'){if(!n.shadowRoot)return[i,n===document?null:n];n=n.shadowRoot;}
+else if(k==='c')n=n.querySelector(v);
+else if(k==='x')n=document.evaluate(v,n,null,9,null).singleNodeValue;
+else return[i,n===document?null:n];
+if(!n)return null;}
+return n;)";
+
+} // namespace detail
+
+/**
+ * A path to an element across shadow roots and frames which is resolved with as few requests as possible by
+ * `Session::async_find_element()`. All steps between two frames are resolved by a single script; only
+ * entering a frame needs an additional request. Steps which cannot be done by the script fall back to the
+ * equivalent native command.
+ *
+ * ```cpp
+ * const auto card = wdlite::Locator{ "checkout-form" }
+ *                     .shadow_root()
+ *                     .find("iframe.payment")
+ *                     .frame()
+ *                     .find("//input[@name='card']", wdlite::LocatorStrategy::xpath);
+ * ```
+ */
+class Locator {
+public:
+	struct Step {
+		enum class Kind {
+			/// Finds the first matching element within the current context.
+			find,
+			/// Enters the shadow root of the current element.
+			shadow_root,
+			/// Enters the frame of the current element. This switches the current browsing context of the session.
+			frame,
+		};
+
+		Kind kind;
+		LocatorStrategy strategy;
+		std::string selector;
+	};
+
+	Locator() = default;
+	Locator(std::string_view selector, LocatorStrategy strategy = LocatorStrategy::css_selector)
+	{
+		find(selector, strategy);
+	}
+
+	Locator& find(std::string_view selector, LocatorStrategy strategy = LocatorStrategy::css_selector)
+	{
+		_steps.push_back(Step{ Step::Kind::find, strategy, std::string{ selector } });
+		return *this;
+	}
+	/// Throws `std::invalid_argument` if the previous step does not find an element.
+	Locator& shadow_root()
+	{
+		_require_element();
+		_steps.push_back(Step{ Step::Kind::shadow_root, LocatorStrategy::css_selector, {} });
+		return *this;
+	}
+	/// Throws `std::invalid_argument` if the previous step does not find an element.
+	Locator& frame()
+	{
+		_require_element();
+		_steps.push_back(Step{ Step::Kind::frame, LocatorStrategy::css_selector, {} });
+		return *this;
+	}
+
+	bool empty() const noexcept { return _steps.empty(); }
+	const std::vector<Step>& get_steps() const noexcept { return _steps; }
+
+private:
+	std::vector<Step> _steps;
+
+	void _require_element() const
+	{
+		if (_steps.empty() || _steps.back().kind != Step::Kind::find) {
+			throw std::invalid_argument{ "a shadow root or frame must follow an element" };
+		}
+	}
+};
+
+namespace detail {
+
+/// Serializes the steps `[begin, end)` for `resolve_locator_script`.
+inline nlohmann::json make_locator_script_steps(const std::vector<Locator::Step>& steps, std::size_t begin,
+                                                std::size_t end)
+{
+	auto result = nlohmann::json::array();
+	for (auto i = begin; i < end; ++i) {
+		const auto& step = steps[i];
+		if (step.kind == Locator::Step::Kind::shadow_root) {
+			result.push_back(nlohmann::json::array({ "s" }));
+		} else if (step.strategy == LocatorStrategy::css_selector || step.strategy == LocatorStrategy::tag_name) {
+			result.push_back(nlohmann::json::array({ "c", step.selector }));
+		} else if (step.strategy == LocatorStrategy::xpath) {
+			result.push_back(nlohmann::json::array({ "x", step.selector }));
+		} else {
+			// The link text strategies are left to the remote end.
+			result.push_back(nlohmann::json::array({ "n" }));
+		}
+	}
+	return result;
+}
+
+} // namespace detail
+
+} // namespace wdlite
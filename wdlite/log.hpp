@@ -1,11 +1,380 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <ctime>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
 #if defined(WDLITE_ENABLE_LOGGING)
-#include <iostream>
+#	include <iostream>
+#endif
+
+/**
+ * Logs an event if `level` is enabled. The arguments are only evaluated when the level is enabled. Formatting
+ * and output happen on a background thread.
+ *
+ * @param level The `wdlite::log::Level`.
+ * @param event A string literal describing the event, e.g. `"request"`.
+ * @param context Additional context like the endpoint.
+ * @param payload The payload which is truncated and sampled according to the configuration.
+ */
+#define WDLITE_LOG(level, event, context, payload)                                                           \
+	do {                                                                                                       \
+		if (::wdlite::log::is_enabled(level)) {                                                                  \
+			::wdlite::log::write(level, event, context, payload);                                                  \
+		}                                                                                                        \
+	} while (false)
+#define WDLITE_INFO(event, context, payload) WDLITE_LOG(::wdlite::log::Level::info, event, context, payload)
+#define WDLITE_DEBUG(event, context, payload) WDLITE_LOG(::wdlite::log::Level::debug, event, context, payload)
+
+namespace wdlite::log {
+
+enum class Level {
+	trace,
+	debug,
+	info,
+	warning,
+	error,
+	off,
+};
 
-#define WDLITE_INFO(log) std::cout << "INFO: " << log << "\n"
-#define WDLITE_DEBUG(log) std::cout << "DEBUG: " << log << "\n"
+struct Record {
+	Level level = Level::off;
+	std::chrono::system_clock::time_point time;
+	/// A static description of the event.
+	const char* event = "";
+	std::string context;
+	/// The payload which may be truncated.
+	std::string payload;
+	/// The size of the payload before truncation.
+	std::size_t payload_size = 0;
+};
+
+/// Receives the records on the background thread. Only one record is written at a time.
+class Sink {
+public:
+	virtual ~Sink() = default;
+	virtual void write(const Record& record) = 0;
+	/// Called when no more records are pending.
+	virtual void flush() {}
+};
+
+/// Writes one line per record to a stream.
+class OstreamSink : public Sink {
+public:
+	/// The stream must outlive the sink.
+	explicit OstreamSink(std::ostream& stream) noexcept : _stream{ stream } {}
+
+	void write(const Record& record) override
+	{
+		constexpr const char* levels[] = { "TRACE", "DEBUG", "INFO", "WARNING", "ERROR", "OFF" };
+		const auto time = std::chrono::system_clock::to_time_t(record.time);
+		const auto milliseconds =
+		  std::chrono::duration_cast<std::chrono::milliseconds>(record.time.time_since_epoch()).count() % 1000;
+		std::tm tm{};
+#if defined(_WIN32)
+		gmtime_s(&tm, &time);
 #else
-#define WDLITE_INFO(log) static_cast<void>(0)
-#define WDLITE_DEBUG(log) static_cast<void>(0)
+		gmtime_r(&time, &tm);
 #endif
+
+		_stream << std::put_time(&tm, "%FT%T") << '.' << std::setw(3) << std::setfill('0') << milliseconds << "Z "
+		        << levels[static_cast<int>(record.level)] << ' ' << record.event;
+		if (!record.context.empty()) {
+			_stream << ' ' << record.context;
+		}
+		if (!record.payload.empty()) {
+			_stream << ": " << record.payload;
+		}
+		if (record.payload_size > record.payload.size()) {
+			_stream << "... (" << record.payload_size - record.payload.size() << " bytes truncated)";
+		}
+		_stream << '\n';
+	}
+	void flush() override { _stream.flush(); }
+
+private:
+	std::ostream& _stream;
+};
+
+namespace detail {
+
+/// Bounded lock-free multi-producer multi-consumer queue (D. Vyukov). Producers never block.
+class RingBuffer {
+public:
+	/// `capacity` is rounded up to a power of two.
+	explicit RingBuffer(std::size_t capacity)
+	{
+		std::size_t size = 2;
+		while (size < capacity) {
+			size *= 2;
+		}
+		_cells = std::vector<Cell>(size);
+		_mask = size - 1;
+		for (std::size_t i = 0; i < size; ++i) {
+			_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	/// Returns `false` if the buffer is full.
+	bool try_push(Record& record) noexcept
+	{
+		auto position = _enqueue.load(std::memory_order_relaxed);
+		while (true) {
+			auto& cell = _cells[position & _mask];
+			const auto sequence = cell.sequence.load(std::memory_order_acquire);
+			const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+			if (difference == 0) {
+				if (_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					cell.record = std::move(record);
+					cell.sequence.store(position + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (difference < 0) {
+				return false;
+			} else {
+				position = _enqueue.load(std::memory_order_relaxed);
+			}
+		}
+	}
+	/// Returns `false` if the buffer is empty.
+	bool try_pop(Record& record) noexcept
+	{
+		auto position = _dequeue.load(std::memory_order_relaxed);
+		while (true) {
+			auto& cell = _cells[position & _mask];
+			const auto sequence = cell.sequence.load(std::memory_order_acquire);
+			const auto difference =
+			  static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+			if (difference == 0) {
+				if (_dequeue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					record = std::move(cell.record);
+					cell.sequence.store(position + _mask + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (difference < 0) {
+				return false;
+			} else {
+				position = _dequeue.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+private:
+	struct Cell {
+		std::atomic<std::size_t> sequence{ 0 };
+		Record record;
+
+		Cell() = default;
+		// Only needed for the construction of the vector.
+		Cell(Cell&& move) noexcept : sequence{ move.sequence.load() }, record{ std::move(move.record) } {}
+	};
+
+	std::vector<Cell> _cells;
+	std::size_t _mask = 0;
+	alignas(64) std::atomic<std::size_t> _enqueue{ 0 };
+	alignas(64) std::atomic<std::size_t> _dequeue{ 0 };
+};
+
+/// The background logger. The configuration is read without locks by the producers.
+class Logger {
+public:
+	std::atomic<Level> level{ Level::off };
+	std::atomic<std::size_t> max_payload_size{ 1024 };
+	std::atomic<unsigned int> sample_rate{ 1 };
+	std::atomic<unsigned int> sample_counter{ 0 };
+	std::atomic<std::size_t> dropped{ 0 };
+
+	Logger() : _buffer{ 4096 }
+	{
+#if defined(WDLITE_ENABLE_LOGGING)
+		level = Level::debug;
+		_sink = std::make_shared<OstreamSink>(std::cout);
+#endif
+	}
+	void push(Record record)
+	{
+		if (_stop.load(std::memory_order_acquire)) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		} else if (!_started.load(std::memory_order_acquire)) {
+			_start();
+		}
+		if (!_buffer.try_push(record)) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		_pushed.fetch_add(1, std::memory_order_acq_rel);
+		if (_sleeping.load(std::memory_order_acquire)) {
+			_condition.notify_one();
+		}
+	}
+	void set_sink(std::shared_ptr<Sink> sink)
+	{
+		std::lock_guard<std::mutex> lock{ _sink_mutex };
+		_sink = std::move(sink);
+	}
+	/// Blocks until all records pushed before were written.
+	void flush()
+	{
+		if (!_started.load(std::memory_order_acquire) || _stop.load(std::memory_order_acquire)) {
+			return;
+		}
+		const auto target = _pushed.load(std::memory_order_acquire);
+		std::unique_lock<std::mutex> lock{ _mutex };
+		_condition.notify_one();
+		_flushed.wait_for(lock, std::chrono::seconds{ 1 }, [&] { return _written >= target; });
+	}
+	/// Writes the pending records and joins the background thread. Later records are dropped.
+	void stop()
+	{
+		std::lock_guard<std::mutex> lock{ _stop_mutex };
+		_stop.store(true, std::memory_order_release);
+		// Prevents a start afterwards.
+		std::call_once(_once, [] {});
+		_condition.notify_one();
+		if (_thread.joinable()) {
+			_thread.join();
+		}
+	}
+
+private:
+	RingBuffer _buffer;
+	std::shared_ptr<Sink> _sink;
+	std::mutex _sink_mutex;
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	std::condition_variable _flushed;
+	std::atomic<bool> _started{ false };
+	std::atomic<bool> _sleeping{ false };
+	std::atomic<bool> _stop{ false };
+	std::mutex _stop_mutex;
+	std::atomic<std::size_t> _pushed{ 0 };
+	std::size_t _written = 0;
+	std::once_flag _once;
+	std::thread _thread;
+
+	void _start()
+	{
+		std::call_once(_once, [this] {
+			_thread = std::thread{ [this] { _run(); } };
+			_started.store(true, std::memory_order_release);
+		});
+	}
+	void _run()
+	{
+		Record record{};
+		while (true) {
+			std::size_t count = 0;
+			{
+				std::lock_guard<std::mutex> lock{ _sink_mutex };
+				while (_buffer.try_pop(record)) {
+					if (_sink) {
+						_sink->write(record);
+					}
+					++count;
+				}
+				if (count > 0 && _sink) {
+					_sink->flush();
+				}
+			}
+
+			std::unique_lock<std::mutex> lock{ _mutex };
+			_written += count;
+			_flushed.notify_all();
+			if (count == 0 && _stop.load()) {
+				break;
+			}
+			_sleeping.store(true, std::memory_order_release);
+			// The timeout covers wake ups lost between the check and the wait.
+			_condition.wait_for(lock, std::chrono::milliseconds{ 10 });
+			_sleeping.store(false, std::memory_order_release);
+		}
+	}
+};
+
+inline Logger& logger()
+{
+	// Never destroyed, so that its thread is not joined during static destruction. See `log::stop()`.
+	static const auto logger = new Logger{};
+	return *logger;
+}
+
+} // namespace detail
+
+/// Sets the minimum level of records which are logged. `Level::off` disables logging, which is the default
+/// unless compiled with `WDLITE_ENABLE_LOGGING`.
+inline void set_level(Level level) noexcept
+{
+	detail::logger().level.store(level, std::memory_order_relaxed);
+}
+
+inline Level get_level() noexcept { return detail::logger().level.load(std::memory_order_relaxed); }
+
+inline bool is_enabled(Level level) noexcept
+{
+	return level != Level::off && level >= detail::logger().level.load(std::memory_order_relaxed);
+}
+
+/// Sets the sink receiving the records. Without a sink, records are discarded.
+inline void set_sink(std::shared_ptr<Sink> sink) { detail::logger().set_sink(std::move(sink)); }
+
+/// Payloads like request and response bodies are truncated to this size. The default is 1024 bytes.
+inline void set_max_payload_size(std::size_t size) noexcept
+{
+	detail::logger().max_payload_size.store(size, std::memory_order_relaxed);
+}
+
+/// Only every n-th record with a payload is logged. The default is 1, i.e. every record.
+inline void set_sample_rate(unsigned int every_nth) noexcept
+{
+	detail::logger().sample_rate.store(every_nth == 0 ? 1 : every_nth, std::memory_order_relaxed);
+}
+
+/// The number of records dropped because the background thread could not keep up.
+inline std::size_t get_dropped_count() noexcept
+{
+	return detail::logger().dropped.load(std::memory_order_relaxed);
+}
+
+/// Blocks until all records logged before were handed to the sink.
+inline void flush() { detail::logger().flush(); }
+
+/**
+ * Hands the pending records to the sink and stops the background thread. Records logged afterwards are
+ * dropped. Call this before returning from `main()`, otherwise records still pending at exit are lost and the
+ * thread may still use the sink while static objects are destroyed.
+ */
+inline void stop() { detail::logger().stop(); }
+
+/// Hands the record to the background thread. Prefer `WDLITE_LOG()` which skips disabled levels cheaply.
+inline void write(Level level, const char* event, std::string_view context, std::string_view payload)
+{
+	auto& logger = detail::logger();
+	if (!payload.empty()) {
+		const auto rate = logger.sample_rate.load(std::memory_order_relaxed);
+		if (rate > 1 && logger.sample_counter.fetch_add(1, std::memory_order_relaxed) % rate != 0) {
+			return;
+		}
+	}
+
+	Record record{};
+	record.level = level;
+	record.time = std::chrono::system_clock::now();
+	record.event = event;
+	record.context = context;
+	record.payload = payload.substr(0, logger.max_payload_size.load(std::memory_order_relaxed));
+	record.payload_size = payload.size();
+	logger.push(std::move(record));
+}
+
+} // namespace wdlite::log
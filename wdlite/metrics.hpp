@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace wdlite {
+
+/// Resource usage of a session on the client side. See `Session::get_statistics()`.
+struct SessionStatistics {
+	/// The number of commands which were issued.
+	std::size_t commands = 0;
+	/// The number of commands which were sent and not yet answered.
+	std::size_t in_flight = 0;
+	/// The accumulated size of the request bodies.
+	std::uint64_t bytes_sent = 0;
+	/// The accumulated size of the response bodies.
+	std::uint64_t bytes_received = 0;
+	/// The size of the largest response body which had to be buffered.
+	std::size_t peak_response_size = 0;
+	/// The number of responses which were aborted because they exceeded the maximum response size.
+	std::size_t oversized_responses = 0;
+	/// The number of `Element` handles which are alive.
+	std::size_t elements = 0;
+};
+
+/// Resource usage of the page in the browser. See `Session::async_get_browser_metrics()`.
+struct BrowserMetrics {
+	/// The used size of the JavaScript heap in bytes.
+	std::uint64_t js_heap_used = 0;
+	/// The total size of the JavaScript heap in bytes.
+	std::uint64_t js_heap_total = 0;
+	/// The number of DOM nodes including those which are detached but not yet collected.
+	std::size_t nodes = 0;
+	/// The number of documents including frames and detached documents which are not yet collected.
+	std::size_t documents = 0;
+	/// The number of registered JavaScript event listeners.
+	std::size_t event_listeners = 0;
+};
+
+namespace detail {
+
+/// The counters behind `SessionStatistics`. Thread-safe because element handles may be released anywhere.
+struct SessionCounters {
+	std::atomic<std::size_t> commands{ 0 };
+	std::atomic<std::size_t> in_flight{ 0 };
+	std::atomic<std::uint64_t> bytes_sent{ 0 };
+	std::atomic<std::uint64_t> bytes_received{ 0 };
+	std::atomic<std::size_t> peak_response_size{ 0 };
+	std::atomic<std::size_t> oversized_responses{ 0 };
+	std::atomic<std::size_t> elements{ 0 };
+
+	void add_response(std::size_t size) noexcept
+	{
+		bytes_received.fetch_add(size, std::memory_order_relaxed);
+		auto peak = peak_response_size.load(std::memory_order_relaxed);
+		while (peak < size && !peak_response_size.compare_exchange_weak(peak, size, std::memory_order_relaxed)) {
+		}
+	}
+	SessionStatistics get_statistics() const noexcept
+	{
+		SessionStatistics statistics{};
+		statistics.commands = commands.load(std::memory_order_relaxed);
+		statistics.in_flight = in_flight.load(std::memory_order_relaxed);
+		statistics.bytes_sent = bytes_sent.load(std::memory_order_relaxed);
+		statistics.bytes_received = bytes_received.load(std::memory_order_relaxed);
+		statistics.peak_response_size = peak_response_size.load(std::memory_order_relaxed);
+		statistics.oversized_responses = oversized_responses.load(std::memory_order_relaxed);
+		statistics.elements = elements.load(std::memory_order_relaxed);
+		return statistics;
+	}
+};
+
+/**
+ * Counts the `Element` handles which are alive. Shares the counters because assigning an element may destroy
+ * the session of the old one before the tracker is assigned.
+ */
+class ElementTracker {
+public:
+	explicit ElementTracker(std::shared_ptr<SessionCounters> counters) noexcept
+	    : _counters{ std::move(counters) }
+	{
+		_acquire();
+	}
+	ElementTracker(const ElementTracker& copy) noexcept : _counters{ copy._counters } { _acquire(); }
+	ElementTracker(ElementTracker&& move) noexcept = default;
+	~ElementTracker() { _release(); }
+
+	ElementTracker& operator=(const ElementTracker& copy) noexcept
+	{
+		if (this != &copy) {
+			_release();
+			_counters = copy._counters;
+			_acquire();
+		}
+		return *this;
+	}
+	ElementTracker& operator=(ElementTracker&& move) noexcept
+	{
+		if (this != &move) {
+			_release();
+			_counters = std::move(move._counters);
+		}
+		return *this;
+	}
+
+private:
+	std::shared_ptr<SessionCounters> _counters;
+
+	void _acquire() noexcept
+	{
+		if (_counters != nullptr) {
+			_counters->elements.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	void _release() noexcept
+	{
+		if (_counters != nullptr) {
+			_counters->elements.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+};
+
+} // namespace detail
+
+} // namespace wdlite
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "session.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace wdlite {
+
+/**
+ * A set of WebDriver endpoints, e.g. one chromedriver per core, which new sessions are spread across. A
+ * new session is placed on the healthy endpoint with the fewest sessions and, among equally loaded ones, the
+ * lowest recent latency. If the endpoint fails to create the session, the next one is tried. An endpoint
+ * which cannot be reached is also marked unhealthy.
+ *
+ * ```cpp
+ * auto pool = std::make_shared<wdlite::EndpointPool>(std::vector{
+ *   std::make_shared<wdlite::Endpoint>("http://localhost:9515"),
+ *   std::make_shared<wdlite::Endpoint>("http://localhost:9516") });
+ * pool->start_health_checks(executor, std::chrono::seconds{ 10 });
+ * auto session = co_await wdlite::async_new_session(executor, pool, capabilities, asio::use_awaitable);
+ * ```
+ */
+class EndpointPool : public std::enable_shared_from_this<EndpointPool> {
+public:
+	using executor_type = Session::executor_type;
+	using duration = std::chrono::steady_clock::duration;
+
+	explicit EndpointPool(std::vector<std::shared_ptr<Endpoint>> endpoints = {});
+	EndpointPool(const EndpointPool& copy) = delete;
+	~EndpointPool();
+
+	void add_endpoint(std::shared_ptr<Endpoint> endpoint);
+	const std::vector<std::shared_ptr<Endpoint>>& get_endpoints() const noexcept;
+	/// The healthy endpoints in the order they are preferred for new sessions.
+	std::vector<std::shared_ptr<Endpoint>> rank() const;
+
+	/**
+	 * Queries the status of all endpoints concurrently and updates their health. An endpoint is healthy if it
+	 * answers and reports to be ready for new sessions.
+	 *
+	 * @param executor The executor of the status requests.
+	 * @param token The ASIO completion token.
+	 * @return The number of healthy endpoints stored in a `std::size_t` depending on `token`.
+	 */
+	template<typename Token>
+	auto async_check_health(executor_type executor, Token&& token);
+	/// Endpoints which do not answer a health check within this time are unhealthy. Defaults to 5 seconds.
+	void set_health_check_timeout(duration timeout) noexcept;
+	/// Runs `async_check_health()` now and then every `interval` until stopped or the pool is destroyed.
+	void start_health_checks(executor_type executor, duration interval);
+	void stop_health_checks();
+
+	EndpointPool& operator=(const EndpointPool& copy) = delete;
+
+private:
+	std::vector<std::shared_ptr<Endpoint>> _endpoints;
+	duration _health_check_timeout = std::chrono::seconds{ 5 };
+	/// The timer of the running periodic health checks.
+	std::shared_ptr<CURLIO_ASIO_NS::steady_timer> _health_timer;
+
+	void _schedule_health_checks(std::shared_ptr<CURLIO_ASIO_NS::steady_timer> timer, duration interval);
+};
+
+/**
+ * Creates a new session on the preferred endpoint of the pool. See `EndpointPool` for the placement. Fails
+ * with the last error of a WebDriver, e.g. `Code::session_not_created`, if all endpoints refused the session
+ * and with `Code::no_healthy_endpoint` if none could be reached.
+ *
+ * @param executor The ASIO executor for the HTTP request and asynchronous actions.
+ * @param pool The endpoints. The chosen one is available through `Session::get_endpoint()`.
+ * @param capabilities Desired capabilities sent to the WebDriver.
+ * @param token The ASIO completion token.
+ * @return A newly created session as `std::shared_ptr<Session>`.
+ */
+template<typename Token>
+auto async_new_session(Session::executor_type executor, std::shared_ptr<EndpointPool> pool,
+                       nlohmann::json capabilities, Token&& token);
+
+} // namespace wdlite
@@ -0,0 +1,184 @@
+#include "pool.hpp"
+#include "session.inl"
+
+#include <algorithm>
+
+namespace wdlite {
+
+namespace detail {
+
+/// The shared state of `EndpointPool::async_check_health()`.
+struct HealthCheck {
+	std::vector<std::shared_ptr<Endpoint>> endpoints;
+	std::vector<bool> answered;
+	std::size_t remaining;
+	std::size_t healthy = 0;
+	/// Expires at the deadline or once all endpoints answered.
+	CURLIO_ASIO_NS::steady_timer timer;
+	/// Set at the deadline. Later answers must not change the health anymore.
+	bool finished = false;
+};
+
+} // namespace detail
+
+inline EndpointPool::EndpointPool(std::vector<std::shared_ptr<Endpoint>> endpoints)
+    : _endpoints{ std::move(endpoints) }
+{}
+
+inline EndpointPool::~EndpointPool() { stop_health_checks(); }
+
+inline void EndpointPool::add_endpoint(std::shared_ptr<Endpoint> endpoint)
+{
+	_endpoints.push_back(std::move(endpoint));
+}
+
+inline const std::vector<std::shared_ptr<Endpoint>>& EndpointPool::get_endpoints() const noexcept
+{
+	return _endpoints;
+}
+
+inline std::vector<std::shared_ptr<Endpoint>> EndpointPool::rank() const
+{
+	std::vector<std::shared_ptr<Endpoint>> endpoints{};
+	for (const auto& endpoint : _endpoints) {
+		if (endpoint->is_healthy()) {
+			endpoints.push_back(endpoint);
+		}
+	}
+	std::stable_sort(endpoints.begin(), endpoints.end(), [](const auto& left, const auto& right) {
+		const auto left_sessions = left->get_session_count();
+		const auto right_sessions = right->get_session_count();
+		return left_sessions < right_sessions ||
+		       (left_sessions == right_sessions && left->get_latency() < right->get_latency());
+	});
+	return endpoints;
+}
+
+inline void EndpointPool::set_health_check_timeout(duration timeout) noexcept
+{
+	_health_check_timeout = timeout;
+}
+
+template<typename Token>
+inline auto EndpointPool::async_check_health(executor_type executor, Token&& token)
+{
+	auto state = std::make_shared<detail::HealthCheck>(detail::HealthCheck{
+	  _endpoints, std::vector<bool>(_endpoints.size()), _endpoints.size(), 0,
+	  CURLIO_ASIO_NS::steady_timer{ executor, std::chrono::steady_clock::now() + _health_check_timeout } });
+
+	return CURLIO_ASIO_NS::async_compose<Token, void(curlio::detail::asio_error_code, std::size_t)>(
+	  [executor, state = std::move(state),
+	   started = false](auto& self, curlio::detail::asio_error_code /* ec */ = {}) mutable {
+		  if (started) {
+			  state->finished = true;
+			  // Endpoints which did not answer in time are considered unhealthy.
+			  for (std::size_t i = 0; i < state->endpoints.size(); ++i) {
+				  if (!state->answered[i]) {
+					  state->endpoints[i]->set_healthy(false);
+				  }
+			  }
+			  self.complete(curlio::detail::asio_error_code{}, state->healthy);
+			  return;
+		  }
+
+		  started = true;
+		  if (state->endpoints.empty()) {
+			  state->timer.expires_at(CURLIO_ASIO_NS::steady_timer::time_point::min());
+		  }
+		  const auto session = curlio::make_session(executor);
+		  const auto queue = std::make_shared<detail::CommandQueue>(state->endpoints.size());
+		  for (std::size_t i = 0; i < state->endpoints.size(); ++i) {
+			  detail::perform_request(
+			    session, state->endpoints[i], queue, nullptr, detail::Access::read,
+			    detail::Command{ detail::Method::get, "status", {} },
+			    [state, i](curlio::detail::asio_error_code ec, bool ready) {
+				    if (state->finished || state->answered[i]) {
+					    return;
+				    }
+				    state->answered[i] = true;
+				    state->endpoints[i]->set_healthy(!ec && ready);
+				    state->healthy += !ec && ready;
+				    if (--state->remaining == 0) {
+					    state->timer.expires_at(CURLIO_ASIO_NS::steady_timer::time_point::min());
+				    }
+			    },
+			    [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+				    if (!detail::check_error(ec, response)) {
+					    return false;
+				    }
+				    const auto& value = response["value"];
+				    return value.is_object() && value.value("ready", false);
+			    });
+		  }
+		  state->timer.async_wait(std::move(self));
+	  },
+	  token, executor);
+}
+
+inline void EndpointPool::start_health_checks(executor_type executor, duration interval)
+{
+	stop_health_checks();
+	_health_timer = std::make_shared<CURLIO_ASIO_NS::steady_timer>(std::move(executor));
+	_schedule_health_checks(_health_timer, interval);
+}
+
+inline void EndpointPool::stop_health_checks()
+{
+	if (_health_timer != nullptr) {
+		_health_timer->cancel();
+		_health_timer = nullptr;
+	}
+}
+
+inline void EndpointPool::_schedule_health_checks(std::shared_ptr<CURLIO_ASIO_NS::steady_timer> timer,
+                                                  duration interval)
+{
+	async_check_health(timer->get_executor(), [pool = weak_from_this(), timer, interval](
+	                                            curlio::detail::asio_error_code /* ec */, std::size_t) {
+		const auto self = pool.lock();
+		if (self == nullptr || self->_health_timer != timer) {
+			return;
+		}
+		timer->expires_after(interval);
+		timer->async_wait([pool, timer, interval](curlio::detail::asio_error_code ec) {
+			const auto self = pool.lock();
+			if (!ec && self != nullptr && self->_health_timer == timer) {
+				self->_schedule_health_checks(timer, interval);
+			}
+		});
+	});
+}
+
+template<typename Token>
+inline auto async_new_session(Session::executor_type executor, std::shared_ptr<EndpointPool> pool,
+                              nlohmann::json capabilities, Token&& token)
+{
+	using Signature = void(curlio::detail::asio_error_code, std::shared_ptr<Session>);
+	return CURLIO_ASIO_NS::async_compose<Token, Signature>(
+	  [executor, candidates = pool->rank(), next = std::size_t{ 0 }, capabilities = std::move(capabilities),
+	   refused = curlio::detail::asio_error_code{}](auto& self, curlio::detail::asio_error_code ec = {},
+	                                               std::shared_ptr<Session> session = nullptr) mutable {
+		  if (session != nullptr) {
+			  self.complete(ec, std::move(session));
+			  return;
+		  } else if (ec == Condition::webdriver_error) {
+			  // The endpoint is up but refused the session, e.g. because it is full. Another one may accept it.
+			  refused = ec;
+		  } else if (ec) {
+			  candidates[next - 1]->set_healthy(false);
+		  }
+
+		  if (next == candidates.size() && refused) {
+			  self.complete(refused, nullptr);
+			  return;
+		  } else if (next == candidates.size()) {
+			  self.complete(Code::no_healthy_endpoint, nullptr);
+			  return;
+		  }
+		  const auto& endpoint = candidates[next++];
+		  async_new_session(executor, endpoint, capabilities, std::move(self));
+	  },
+	  token, executor);
+}
+
+} // namespace wdlite
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <curlio/curlio.hpp>
+#include <deque>
+#include <memory>
+
+namespace wdlite {
+
+/// Statistics of the command queue of a session. See `Session::get_queue_statistics()`.
+struct QueueStatistics {
+	using duration = std::chrono::steady_clock::duration;
+
+	/// The number of commands which were started.
+	std::size_t commands = 0;
+	/// The number of commands which had to wait before they were started.
+	std::size_t delayed_commands = 0;
+	/// The accumulated time commands waited in the queue.
+	duration total_wait{};
+	/// The longest time a single command waited in the queue.
+	duration max_wait{};
+	/// The number of commands currently running.
+	std::size_t in_flight = 0;
+	/// The number of commands currently waiting.
+	std::size_t waiting = 0;
+};
+
+namespace detail {
+
+enum class Access {
+	/// The command does not change the state of the browser and may run concurrently with other reads.
+	read,
+	/// The command may change the state of the browser and runs alone in the order it was issued.
+	write,
+};
+
+/**
+ * Orders the commands of a session. Reads may overlap with other reads up to the maximum in-flight depth
+ * while writes wait for everything issued before and block everything issued after them. Commands are started
+ * strictly in FIFO order.
+ */
+class CommandQueue {
+public:
+	using clock = std::chrono::steady_clock;
+
+	struct Waiter {
+		Access access;
+		clock::time_point enqueued;
+		/// Cancelled once the command may start.
+		CURLIO_ASIO_NS::steady_timer timer;
+		bool granted = false;
+	};
+
+	explicit CommandQueue(std::size_t max_in_flight) noexcept
+	    : _max_in_flight{ std::max<std::size_t>(max_in_flight, 1) }
+	{}
+
+	void set_max_in_flight(std::size_t max_in_flight)
+	{
+		_max_in_flight = std::max<std::size_t>(max_in_flight, 1);
+		_dispatch();
+	}
+	std::size_t get_max_in_flight() const noexcept { return _max_in_flight; }
+	QueueStatistics get_statistics() const noexcept
+	{
+		auto statistics = _statistics;
+		statistics.in_flight = _writing ? 1 : _reads;
+		statistics.waiting = _waiters.size();
+		return statistics;
+	}
+	/// Acquires a slot if nothing is waiting and the access is possible right now.
+	bool try_acquire(Access access) noexcept
+	{
+		if (!_waiters.empty() || !_can_start(access)) {
+			return false;
+		}
+		_start(access, clock::duration{});
+		return true;
+	}
+	/// Queues the command. Wait on the timer of the returned waiter until it was granted.
+	std::shared_ptr<Waiter> enqueue(const curlio::Session::executor_type& executor, Access access)
+	{
+		auto waiter = std::make_shared<Waiter>(
+		  Waiter{ access, clock::now(),
+		          CURLIO_ASIO_NS::steady_timer{ executor, CURLIO_ASIO_NS::steady_timer::time_point::max() } });
+		_waiters.push_back(waiter);
+		return waiter;
+	}
+	/// Removes a waiter which was woken up without being granted.
+	void cancel(const std::shared_ptr<Waiter>& waiter)
+	{
+		_waiters.erase(std::remove(_waiters.begin(), _waiters.end(), waiter), _waiters.end());
+		_dispatch();
+	}
+	/// Must be called exactly once for every started command.
+	void release(Access access)
+	{
+		if (access == Access::write) {
+			_writing = false;
+		} else if (_reads > 0) {
+			--_reads;
+		}
+		_dispatch();
+	}
+
+private:
+	std::size_t _max_in_flight;
+	std::size_t _reads = 0;
+	bool _writing = false;
+	std::deque<std::shared_ptr<Waiter>> _waiters;
+	QueueStatistics _statistics;
+
+	bool _can_start(Access access) const noexcept
+	{
+		return !_writing && (access == Access::write ? _reads == 0 : _reads < _max_in_flight);
+	}
+	void _start(Access access, clock::duration wait) noexcept
+	{
+		if (access == Access::write) {
+			_writing = true;
+		} else {
+			++_reads;
+		}
+		++_statistics.commands;
+		if (wait > clock::duration{}) {
+			++_statistics.delayed_commands;
+			_statistics.total_wait += wait;
+			_statistics.max_wait = std::max(_statistics.max_wait, wait);
+		}
+	}
+	void _dispatch()
+	{
+		// Only the head may start to keep the order.
+		while (!_waiters.empty() && _can_start(_waiters.front()->access)) {
+			const auto waiter = std::move(_waiters.front());
+			_waiters.pop_front();
+			_start(waiter->access, clock::now() - waiter->enqueued);
+			waiter->granted = true;
+			waiter->timer.cancel();
+		}
+	}
+};
+
+} // namespace detail
+
+} // namespace wdlite
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "endpoint.hpp"
+#include "metrics.hpp"
+#include "queue.hpp"
+#include "tape.hpp"
+
+#include <cstddef>
+#include <curlio/curlio.hpp>
+#include <memory>
+#include <new>
+#include <nlohmann/json.hpp>
+#include <utility>
+
+#if defined(WDLITE_SEPARATE_COMPILATION)
+#	define WDLITE_DECL
+#else
+#	define WDLITE_DECL inline
+#endif
+
+namespace wdlite {
+
+namespace detail {
+
+/**
+ * A type-erased and move-only `void(curlio::detail::asio_error_code, nlohmann::json)` callback. Small
+ * callbacks like the adapted completion handlers are stored inline so that no allocation is needed.
+ */
+class RequestHandler {
+public:
+	/// Fits the completion handlers adapted by `perform_request()` for the common tokens.
+	constexpr static std::size_t buffer_size = 224;
+
+	template<typename Function>
+	RequestHandler(Function function)
+	{
+		using Type = Implementation<Function>;
+		if constexpr (sizeof(Type) <= buffer_size && alignof(Type) <= alignof(std::max_align_t)) {
+			_function = new (_buffer) Type{ std::move(function) };
+			_inline = true;
+		} else {
+			_function = new Type{ std::move(function) };
+		}
+	}
+	RequestHandler(RequestHandler&& move) noexcept : _inline{ move._inline }
+	{
+		if (_inline) {
+			_function = move._function->move_to(_buffer);
+			move._function = nullptr;
+		} else {
+			_function = std::exchange(move._function, nullptr);
+		}
+	}
+	RequestHandler& operator=(RequestHandler&& move) = delete;
+	~RequestHandler()
+	{
+		if (_inline && _function != nullptr) {
+			_function->~Interface();
+		} else {
+			delete _function;
+		}
+	}
+
+	/// May only be called once.
+	void operator()(curlio::detail::asio_error_code ec, nlohmann::json response)
+	{
+		// The callback may destroy the owner of this instance.
+		RequestHandler function{ std::move(*this) };
+		function._function->invoke(ec, std::move(response));
+	}
+
+private:
+	struct Interface {
+		virtual ~Interface() = default;
+		virtual void invoke(curlio::detail::asio_error_code ec, nlohmann::json response) = 0;
+		/// Moves this instance into the buffer and destroys itself.
+		virtual Interface* move_to(void* buffer) noexcept = 0;
+	};
+
+	template<typename Function>
+	struct Implementation : Interface {
+		Function function;
+
+		explicit Implementation(Function function) : function{ std::move(function) } {}
+		void invoke(curlio::detail::asio_error_code ec, nlohmann::json response) override
+		{
+			function(ec, std::move(response));
+		}
+		Interface* move_to(void* buffer) noexcept override
+		{
+			const auto moved = new (buffer) Implementation{ std::move(function) };
+			this->~Implementation();
+			return moved;
+		}
+	};
+
+	alignas(std::max_align_t) unsigned char _buffer[buffer_size];
+	Interface* _function = nullptr;
+	bool _inline = false;
+};
+
+/**
+ * The core of `perform_request()` which does not depend on the completion token. It waits for the command
+ * queue and the limiter of the endpoint, sends the command or takes it from the replayer and parses the
+ * response. With `WDLITE_SEPARATE_COMPILATION` it is compiled only once into the wdlite library.
+ *
+ * @param counters The counters of the session. May be null.
+ * @param handler Receives the parsed response. Called exactly once from the executor of `session` or,
+ * if the request fails immediately, from within this function.
+ */
+WDLITE_DECL void start_request(std::shared_ptr<curlio::Session> session, std::shared_ptr<Endpoint> endpoint,
+                               std::shared_ptr<CommandQueue> queue, std::shared_ptr<SessionCounters> counters,
+                               Access access, Command command, RequestHandler handler);
+
+} // namespace detail
+
+} // namespace wdlite
+
+#if !defined(WDLITE_SEPARATE_COMPILATION)
+#	include "request.ipp"
+#endif
@@ -0,0 +1,267 @@
+#include "error.hpp"
+#include "log.hpp"
+#include "request.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace wdlite {
+
+namespace detail {
+
+/// The state of a request started by `start_request()`. Kept alive by the pending handlers.
+class RequestOperation : public std::enable_shared_from_this<RequestOperation> {
+public:
+	using clock = std::chrono::steady_clock;
+
+	RequestOperation(std::shared_ptr<curlio::Session> session, std::shared_ptr<Endpoint> endpoint,
+	                 std::shared_ptr<CommandQueue> queue, std::shared_ptr<SessionCounters> counters,
+	                 Access access, Command command, RequestHandler handler)
+	    : _session{ std::move(session) }, _endpoint{ std::move(endpoint) }, _queue{ std::move(queue) },
+	      _counters{ std::move(counters) }, _access{ access }, _command{ std::move(command) },
+	      _handler{ std::move(handler) }
+	{}
+
+	void start()
+	{
+		if (_counters != nullptr) {
+			_counters->commands.fetch_add(1, std::memory_order_relaxed);
+			_counters->bytes_sent.fetch_add(_command.payload.size(), std::memory_order_relaxed);
+		}
+		_acquire_queue();
+	}
+
+private:
+	std::shared_ptr<curlio::Session> _session;
+	std::shared_ptr<Endpoint> _endpoint;
+	std::shared_ptr<CommandQueue> _queue;
+	std::shared_ptr<SessionCounters> _counters;
+	Access _access;
+	Command _command;
+	RequestHandler _handler;
+	bool _acquired = false;
+	/// Whether the request was sent and counts as in flight.
+	bool _sent = false;
+	std::shared_ptr<CommandQueue::Waiter> _waiter;
+	std::shared_ptr<Limiter> _limiter;
+	std::shared_ptr<Limiter::Waiter> _limiter_waiter;
+	clock::time_point _started;
+	std::optional<CURLIO_ASIO_NS::steady_timer> _replay;
+	/// The response body which is read so far. Only the first `_received` bytes are valid.
+	std::string _data;
+	std::size_t _received = 0;
+
+	void _acquire_queue()
+	{
+		if (_queue->try_acquire(_access)) {
+			_acquired = true;
+			_acquire_limiter();
+			return;
+		}
+		_waiter = _queue->enqueue(_session->get_executor(), _access);
+		_waiter->timer.async_wait([self = shared_from_this()](curlio::detail::asio_error_code ec) {
+			const auto waiter = std::move(self->_waiter);
+			if (waiter->granted) {
+				self->_acquired = true;
+				self->_acquire_limiter();
+				return;
+			}
+			self->_queue->cancel(waiter);
+			if (ec) {
+				self->_fail(ec);
+			} else {
+				self->_acquire_queue();
+			}
+		});
+	}
+	void _acquire_limiter()
+	{
+		_limiter = _endpoint->get_limiter();
+		if (_limiter == nullptr || _limiter->try_acquire()) {
+			_send();
+			return;
+		}
+		_limiter_waiter = _limiter->enqueue(_session->get_executor());
+		_limiter_waiter->timer.async_wait([self = shared_from_this()](curlio::detail::asio_error_code ec) {
+			const auto waiter = std::move(self->_limiter_waiter);
+			if (waiter->granted) {
+				self->_send();
+				return;
+			}
+			self->_limiter->cancel(waiter);
+			self->_limiter = nullptr;
+			if (ec) {
+				self->_fail(ec);
+			} else {
+				self->_acquire_limiter();
+			}
+		});
+	}
+	void _send()
+	{
+		_started = clock::now();
+		WDLITE_DEBUG("request", _command.path, _command.payload);
+
+		if (const auto& replayer = _endpoint->get_replayer()) {
+			const auto exchange = replayer->find(_command);
+			if (exchange == nullptr) {
+				_release(false);
+				_complete(Code::no_recorded_response, {});
+				return;
+			}
+			_mark_sent();
+			_replay.emplace(_session->get_executor(), replayer->get_delay(*exchange));
+			_replay->async_wait([self = shared_from_this(),
+			                     replayed = exchange->response](curlio::detail::asio_error_code ec) {
+				self->_replay.reset();
+				if (ec) {
+					self->_fail(ec);
+				} else if (self->_exceeds(replayed.size())) {
+					self->_reject();
+				} else {
+					self->_receive(replayed);
+				}
+			});
+			return;
+		}
+
+		_mark_sent();
+		const auto url = _endpoint->get_url() + _command.path;
+		auto request = curlio::make_request(_session);
+		request->set_option<CURLOPT_URL>(url.c_str());
+		if (_command.method == Method::post) {
+			request->set_option<CURLOPT_COPYPOSTFIELDS>(_command.payload.c_str());
+			request->append_header("content-type: application/json");
+		} else if (_command.method == Method::delete_) {
+			request->set_option<CURLOPT_CUSTOMREQUEST>("DELETE");
+		}
+		_session->async_start(std::move(request), [self = shared_from_this()](
+		                                            curlio::detail::asio_error_code ec,
+		                                            curlio::Session::response_pointer response) {
+			if (ec) {
+				self->_fail(ec);
+			} else {
+				self->_read(std::move(response));
+			}
+		});
+	}
+	/// Reads the body chunk by chunk so that the limit is enforced before the whole body is buffered.
+	void _read(curlio::Session::response_pointer response)
+	{
+		if (_received == _data.size()) {
+			auto size = std::max<std::size_t>(_data.size() * 2, 4096);
+			if (_command.max_response_size != 0 && _command.max_response_size < size) {
+				// One more byte to notice if the limit is crossed.
+				size = _command.max_response_size + 1;
+			}
+			// A fresh buffer because resize() may reserve up to twice the size, beyond the limit.
+			std::string data(size, '\0');
+			std::copy_n(_data.data(), _received, data.data());
+			_data = std::move(data);
+		}
+		auto buffer = CURLIO_ASIO_NS::buffer(_data.data() + _received, _data.size() - _received);
+		auto& stream = *response;
+		stream.async_read_some(buffer, [self = shared_from_this(), response = std::move(response)](
+		                                 curlio::detail::asio_error_code ec, std::size_t size) mutable {
+			self->_received += size;
+			if (self->_exceeds(self->_received)) {
+				// Releasing the response aborts the transfer.
+				response = nullptr;
+				self->_reject();
+			} else if (ec == CURLIO_ASIO_NS::error::make_error_code(CURLIO_ASIO_NS::error::eof)) {
+				self->_receive({ self->_data.data(), self->_received });
+			} else if (ec) {
+				self->_fail(ec);
+			} else {
+				self->_read(std::move(response));
+			}
+		});
+	}
+	void _receive(std::string_view data)
+	{
+		const auto latency = clock::now() - _started;
+		_endpoint->report_latency(latency);
+		_release(false);
+		if (_counters != nullptr) {
+			_counters->add_response(data.size());
+		}
+		WDLITE_DEBUG("response", _command.path, data);
+		if (const auto& recorder = _endpoint->get_recorder(); recorder && !_endpoint->get_replayer()) {
+			recorder->record(_command, data, latency);
+		}
+		auto response = nlohmann::json::parse(data, nullptr, false);
+		if (response.is_discarded()) {
+			WDLITE_LOG(log::Level::warning, "invalid response", _command.path, data);
+			_complete(Code::invalid_response, {});
+			return;
+		}
+		_complete({}, std::move(response));
+	}
+	/// Any error is a bad error.
+	void _fail(curlio::detail::asio_error_code ec)
+	{
+		_release(true);
+		_complete(ec, {});
+	}
+	bool _exceeds(std::size_t size) const noexcept
+	{
+		return _command.max_response_size != 0 && size > _command.max_response_size;
+	}
+	/// The response is too large. This is not the fault of the endpoint.
+	void _reject()
+	{
+		WDLITE_LOG(log::Level::warning, "response too large", _command.path,
+		           std::to_string(_command.max_response_size));
+		_release(false);
+		if (_counters != nullptr) {
+			_counters->oversized_responses.fetch_add(1, std::memory_order_relaxed);
+		}
+		// Assigning an empty string would keep the capacity.
+		std::string{}.swap(_data);
+		_complete(Code::response_too_large, {});
+	}
+	void _mark_sent() noexcept
+	{
+		if (_counters != nullptr) {
+			_counters->in_flight.fetch_add(1, std::memory_order_relaxed);
+			_sent = true;
+		}
+	}
+	void _release(bool failed)
+	{
+		if (_sent) {
+			_counters->in_flight.fetch_sub(1, std::memory_order_relaxed);
+			_sent = false;
+		}
+		if (_acquired) {
+			_queue->release(_access);
+			_acquired = false;
+		}
+		if (_limiter != nullptr) {
+			_limiter->release(clock::now() - _started, failed);
+			_limiter = nullptr;
+		}
+	}
+	void _complete(curlio::detail::asio_error_code ec, nlohmann::json response)
+	{
+		auto handler = std::move(_handler);
+		handler(ec, std::move(response));
+	}
+};
+
+WDLITE_DECL void start_request(std::shared_ptr<curlio::Session> session, std::shared_ptr<Endpoint> endpoint,
+                               std::shared_ptr<CommandQueue> queue, std::shared_ptr<SessionCounters> counters,
+                               Access access, Command command, RequestHandler handler)
+{
+	std::make_shared<RequestOperation>(std::move(session), std::move(endpoint), std::move(queue),
+	                                   std::move(counters), access, std::move(command), std::move(handler))
+	  ->start();
+}
+
+} // namespace detail
+
+} // namespace wdlite
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <curlio/curlio.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace wdlite {
+
+enum class ImageFormat {
+	png,
+	jpeg,
+	webp,
+};
+
+/// Options for `Session::async_take_full_page_screenshot()`.
+struct FullPageScreenshotOptions {
+	ImageFormat format = ImageFormat::png;
+	/// The compression quality from 0 to 100 of JPEG and WebP images.
+	int quality = 90;
+	/// The maximum height of a single capture in CSS pixels. `0` captures the page in a single image, which may
+	/// be cut off by the browser for very long pages.
+	std::uint32_t tile_height = 4096;
+	/// The maximum number of tiles captured at once. The session's in-flight limit applies as well.
+	std::size_t max_parallel = 2;
+	/// Decodes and writes the tiles so the executor of the session is not blocked by the file system. Defaults
+	/// to the system thread pool of ASIO.
+	CURLIO_ASIO_NS::any_io_executor file_executor = CURLIO_ASIO_NS::system_executor{};
+};
+
+/// A part of the page written to its own image file.
+struct ScreenshotTile {
+	std::string path;
+	/// The position and size of the tile on the page in CSS pixels.
+	std::uint32_t x = 0;
+	std::uint32_t y = 0;
+	std::uint32_t width = 0;
+	std::uint32_t height = 0;
+	/// The size of the image file in bytes.
+	std::size_t size = 0;
+};
+
+namespace detail {
+
+inline std::string_view to_string(ImageFormat format) noexcept
+{
+	switch (format) {
+	case ImageFormat::jpeg: return "jpeg";
+	case ImageFormat::webp: return "webp";
+	default: return "png";
+	}
+}
+
+/// Inserts `-<index>` before the extension of `path`.
+inline std::string make_tile_path(std::string_view path, std::size_t index)
+{
+	const auto slash = path.find_last_of("/\\");
+	auto dot = path.rfind('.');
+	if (dot == std::string_view::npos || (slash != std::string_view::npos && dot < slash)) {
+		dot = path.size();
+	}
+	std::string result{ path.substr(0, dot) };
+	result += '-';
+	result += std::to_string(index);
+	result += path.substr(dot);
+	return result;
+}
+
+/**
+ * Decodes the Base64 data directly into the file in fixed-size blocks, so no decoded copy of the image is
+ * held in memory.
+ *
+ * @return The number of bytes written or `0` if the data is invalid or the file could not be written.
+ */
+inline std::size_t write_base64_file(const std::string& path, std::string_view data)
+{
+	constexpr auto decode = [](char c) noexcept -> int {
+		if (c >= 'A' && c <= 'Z') {
+			return c - 'A';
+		} else if (c >= 'a' && c <= 'z') {
+			return c - 'a' + 26;
+		} else if (c >= '0' && c <= '9') {
+			return c - '0' + 52;
+		} else if (c == '+') {
+			return 62;
+		} else if (c == '/') {
+			return 63;
+		}
+		return -1;
+	};
+
+	while (!data.empty() && data.back() == '=') {
+		data.remove_suffix(1);
+	}
+	if (data.empty() || data.size() % 4 == 1) {
+		return 0;
+	}
+	const auto file = std::fopen(path.c_str(), "wb");
+	if (file == nullptr) {
+		return 0;
+	}
+
+	char block[64 * 1024];
+	std::size_t used = 0;
+	std::size_t written = 0;
+	std::uint32_t bits = 0;
+	int count = 0;
+	bool ok = true;
+	for (const auto c : data) {
+		const auto value = decode(c);
+		if (value < 0) {
+			ok = false;
+			break;
+		}
+		bits = bits << 6 | static_cast<std::uint32_t>(value);
+		if (++count == 4) {
+			block[used++] = static_cast<char>(bits >> 16);
+			block[used++] = static_cast<char>(bits >> 8);
+			block[used++] = static_cast<char>(bits);
+			bits = 0;
+			count = 0;
+			if (used > sizeof(block) - 3) {
+				ok = std::fwrite(block, 1, used, file) == used;
+				written += used;
+				used = 0;
+				if (!ok) {
+					break;
+				}
+			}
+		}
+	}
+	if (ok && count == 2) {
+		block[used++] = static_cast<char>(bits >> 4);
+	} else if (ok && count == 3) {
+		block[used++] = static_cast<char>(bits >> 10);
+		block[used++] = static_cast<char>(bits >> 2);
+	}
+	if (ok && used > 0) {
+		ok = std::fwrite(block, 1, used, file) == used;
+		written += used;
+	}
+	ok = std::fclose(file) == 0 && ok;
+	if (!ok) {
+		std::remove(path.c_str());
+		return 0;
+	}
+	return written;
+}
+
+/// The shared state of the tile captures of a full-page screenshot.
+struct FullPageCapture {
+	FullPageScreenshotOptions options;
+	std::vector<ScreenshotTile> tiles;
+	/// The index of the next tile to start.
+	std::size_t next = 0;
+	std::size_t running = 0;
+	curlio::detail::asio_error_code error;
+	/// Expires once all started captures finished.
+	CURLIO_ASIO_NS::steady_timer timer;
+};
+
+} // namespace detail
+
+} // namespace wdlite
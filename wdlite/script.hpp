@@ -0,0 +1,92 @@
+#pragma once
+
+#include "fwd.hpp"
+
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace wdlite {
+
+/**
+ * A script which is installed once per document and afterwards invoked by its short ID. Only the ID and the
+ * arguments are sent for repeated calls. Use it with `Session::async_execute_prepared_script()`.
+ *
+ * The script body is the body of an `async` function. Its result is returned to the caller and a rejection is
+ * reported as `Code::javascript_error`.
+ *
+ * ```cpp
+ * const wdlite::PreparedScript count{ "return document.querySelectorAll(selector).length;", { "selector" } };
+ * ```
+ */
+class PreparedScript {
+public:
+	/**
+	 * @param body The body of the function.
+	 * @param parameters The parameter names in the order of the arguments passed on invocation.
+	 */
+	PreparedScript(std::string_view body, std::initializer_list<std::string_view> parameters = {})
+	{
+		auto data = std::make_shared<Data>();
+
+		std::string function = "async function(";
+		bool first = true;
+		for (const auto parameter : parameters) {
+			if (!first) {
+				function += ',';
+			}
+			first = false;
+			function += parameter;
+		}
+		function += "){";
+		function += body;
+		function += '}';
+
+		// FNV-1a is good enough to tell scripts apart.
+		std::uint64_t hash = 14695981039346656037ull;
+		for (const auto c : function) {
+			hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+		}
+		data->id.reserve(17);
+		data->id = 's';
+		for (int shift = 60; shift >= 0; shift -= 4) {
+			data->id += "0123456789abcdef"[(hash >> shift) & 0xf];
+		}
+
+		data->invoke = "const d=arguments[arguments.length-1],a=arguments[0],s=window.__wdlite_scripts,f=s&&s[\"";
+		data->invoke += data->id;
+		data->invoke += "\"];if(!f){d({missing:true});return;}Promise.resolve().then(()=>f.apply(null,a)).then("
+		                "v=>d({value:v===undefined?null:v}),e=>d({failure:String(e)}));";
+
+		data->install_and_invoke.reserve(function.size() + data->invoke.size() + 64);
+		data->install_and_invoke = "(window.__wdlite_scripts=window.__wdlite_scripts||{})[\"";
+		data->install_and_invoke += data->id;
+		data->install_and_invoke += "\"]=";
+		data->install_and_invoke += function;
+		data->install_and_invoke += ';';
+		data->install_and_invoke += data->invoke;
+
+		_data = std::move(data);
+	}
+
+	/// The ID under which the script is installed in the document.
+	const std::string& get_id() const noexcept { return _data->id; }
+
+private:
+	friend Session;
+
+	struct Data {
+		std::string id;
+		/// Calls the installed function or reports that it is missing.
+		std::string invoke;
+		/// Installs the function and calls it.
+		std::string install_and_invoke;
+	};
+
+	/// Shared so that copies are cheap even for large scripts.
+	std::shared_ptr<const Data> _data;
+};
+
+} // namespace wdlite
@@ -1,12 +1,23 @@
 #pragma once
 
+#include "cache.hpp"
+#include "dom.hpp"
+#include "endpoint.hpp"
+#include "extract.hpp"
 #include "fwd.hpp"
+#include "metrics.hpp"
+#include "queue.hpp"
+#include "screenshot.hpp"
 
+#include <chrono>
 #include <curlio/curlio.hpp>
 #include <memory>
 #include <nlohmann/json.hpp>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace wdlite {
@@ -19,18 +30,49 @@ enum class LocatorStrategy {
 	xpath,
 };
 
+enum class Ownership {
+	/// The remote session is deleted when the `Session` instance is destroyed.
+	owning,
+	/// The remote session is left untouched when the `Session` instance is destroyed.
+	borrowed,
+};
+
+enum class WindowType {
+	tab,
+	window,
+};
+
+/// Options for `async_close_all()`.
+struct CloseAllOptions {
+	/// The maximum number of sessions which are closed at once.
+	std::size_t max_parallel = 16;
+	/// The time after which `async_close_all()` completes even if not all sessions are closed yet.
+	std::chrono::steady_clock::duration deadline = std::chrono::seconds{ 30 };
+};
+
+/// The outcome of `async_close_all()`.
+struct CloseReport {
+	/// The number of sessions which were closed successfully.
+	std::size_t closed = 0;
+	/// The IDs of the sessions which could not be closed together with the error.
+	std::vector<std::pair<std::string, std::error_code>> failed;
+	/// The IDs of the sessions which were not closed before the deadline. Their requests may still finish
+	/// later.
+	std::vector<std::string> stragglers;
+};
+
 class Session : public std::enable_shared_from_this<Session> {
 public:
 	using executor_type = curlio::Session::executor_type;
 
-	/// When the session instance is destroyed. The remote window is closed.
+	/// When the session instance is destroyed and it owns the remote session, the remote session is deleted.
 	~Session();
 
 	/**
 	 * Creates a new session object and opens the session on the remote WebDriver endpoint.
 	 *
 	 * @param executor The ASIO executor for the HTTP request and asynchronous actions.
-	 * @param endpoint The WebDriver endpoint URL. For example: `http://localhost:9515`.
+	 * @param endpoint The WebDriver endpoint. Sessions can share an endpoint to share its settings.
 	 * @param capabilities Desired capabilities sent to the WebDriver. This object can be custom or created by
 	 * `wdlite::capabilities::make()`. See [here](https://w3c.github.io/webdriver/#capabilities) for more
 	 * information.
@@ -38,12 +80,88 @@ public:
 	 * @return A newly created session as `std::shared_ptr<Session>`.
 	 */
 	template<typename Token>
-	friend auto async_new_session(executor_type executor, std::string endpoint, nlohmann::json capabilities,
-	                              Token&& token);
+	friend auto async_new_session(executor_type executor, std::shared_ptr<Endpoint> endpoint,
+	                              nlohmann::json capabilities, Token&& token);
+	/**
+	 * Attaches to an already running session on the remote WebDriver endpoint, for example one created by
+	 * another process. The session is validated with a request before it is returned.
+	 *
+	 * @param executor The ASIO executor for the HTTP request and asynchronous actions.
+	 * @param endpoint The WebDriver endpoint.
+	 * @param session_id The ID of the remote session. See `get_id()`.
+	 * @param ownership Whether the returned instance deletes the remote session on destruction.
+	 * @param token The ASIO completion token.
+	 * @return The attached session as `std::shared_ptr<Session>`.
+	 */
+	template<typename Token>
+	friend auto async_attach_session(executor_type executor, std::shared_ptr<Endpoint> endpoint,
+	                                 std::string session_id, Ownership ownership, Token&& token);
 
 	executor_type get_executor() const noexcept;
 	/// The WebDriver session ID.
 	const std::string& get_id() const noexcept;
+	/// The WebDriver endpoint this session lives on.
+	const std::shared_ptr<Endpoint>& get_endpoint() const noexcept;
+	Ownership get_ownership() const noexcept;
+	void set_ownership(Ownership ownership) noexcept;
+	/**
+	 * Gives up the ownership of the remote session so that it survives this instance. The session can be
+	 * attached again with `async_attach_session()`.
+	 *
+	 * @return The WebDriver session ID.
+	 */
+	const std::string& detach() noexcept;
+	/**
+	 * Deletes the remote session, which closes all of its windows and ends the browser process. Unlike the
+	 * destructor, this signals when the browser is gone. Commands issued before are finished first. The
+	 * instance does not delete the session again on destruction.
+	 *
+	 * @param token The ASIO completion token.
+	 */
+	template<typename Token>
+	auto async_close(Token&& token);
+
+	/**
+	 * Sets how many read-only commands (getters and element lookups) may be in flight at once. Commands which
+	 * may change the browser state (navigation, clicks, input, scripts, ...) always run alone and in the order
+	 * they were issued. The default is 4.
+	 */
+	void set_max_in_flight(std::size_t max_in_flight);
+	std::size_t get_max_in_flight() const noexcept;
+	/// Statistics about the command queue like the time commands had to wait.
+	QueueStatistics get_queue_statistics() const noexcept;
+	/**
+	 * Limits the size of every response body of this session. The body is checked while it is received and the
+	 * transfer is aborted with `Code::response_too_large` as soon as it grows beyond the limit, so a single
+	 * huge page source or script result cannot exhaust the memory. `0` disables the limit, which is the
+	 * default. Some commands take a limit per call which overrides this one.
+	 */
+	void set_max_response_size(std::size_t max_response_size) noexcept;
+	std::size_t get_max_response_size() const noexcept;
+	/// The commands, transferred bytes and element handles of this session so far. Cheap enough to poll.
+	SessionStatistics get_statistics() const noexcept;
+	/**
+	 * Queries the memory usage of the current page in the browser, which grows if a long-running session leaks
+	 * DOM nodes, listeners or heap objects. Both DevTools commands run concurrently as read-only commands. This
+	 * uses the Chrome DevTools Protocol and is only supported by Chromium based browsers.
+	 *
+	 * @param token The ASIO completion token.
+	 * @return The metrics stored in a `BrowserMetrics` depending on `token`.
+	 */
+	template<typename Token>
+	auto async_get_browser_metrics(Token&& token) const;
+
+	/**
+	 * Enables or disables the locator cache. If enabled, the results of `async_find_element()` and
+	 * `async_find_elements()` of the session and its elements are remembered per scope, strategy and selector.
+	 * The cache is cleared by every command which may change the browser state (navigation, clicks, input,
+	 * scripts, ...) and whenever the remote end reports a stale element reference. Lookups which found nothing
+	 * are not cached. Disabled by default.
+	 */
+	void set_locator_cache_enabled(bool enabled);
+	bool is_locator_cache_enabled() const noexcept;
+	void clear_locator_cache() noexcept;
+	LocatorCacheStatistics get_locator_cache_statistics() const noexcept;
 
 	/**
 	 * Instructs the browser to navigate to the given URL.
@@ -77,35 +195,317 @@ public:
 	 */
 	template<typename Token>
 	auto async_get_page_source(Token&& token) const;
+	/**
+	 * Like `async_get_page_source()` with its own maximum response size.
+	 *
+	 * @param max_response_size Overrides the limit of the session. `0` keeps the limit of the session and
+	 * `SIZE_MAX` disables it.
+	 * @param token The ASIO completion token.
+	 */
+	template<typename Token>
+	auto async_get_page_source(std::size_t max_response_size, Token&& token) const;
 
 	template<typename Token>
 	auto async_find_element(std::string_view selector, LocatorStrategy strategy, Token&& token) const;
 	template<typename Token>
 	auto async_find_elements(std::string_view selector, LocatorStrategy strategy, Token&& token) const;
+	/**
+	 * Finds the element at the end of the compound locator starting at the current browsing context. If the
+	 * locator enters frames, the session stays switched to the innermost frame so that the element can be used.
+	 *
+	 * @param locator The path to the element. It must end with a `Locator::find()` step.
+	 * @param token The ASIO completion token.
+	 * @return The result stored in a `std::optional<Element>` depending on `token`. The optional is empty if a
+	 * step found nothing.
+	 */
+	template<typename Token>
+	auto async_find_element(const Locator& locator, Token&& token);
+	/**
+	 * Performs the actions in order with as few requests as possible. Consecutive scripted actions are done by
+	 * a single script which also locates the elements of the native actions following them. Only typing and
+	 * clicking need an additional request per action. Since a click may change the page, it ends the batch.
+	 * The fields of consecutive `FormAction::Kind::type` actions are cleared together before typing.
+	 *
+	 * A failing action does not stop the others.
+	 *
+	 * @param actions The actions. Throws `std::invalid_argument` if a locator enters a frame.
+	 * @param token The ASIO completion token.
+	 * @return The result of every action stored in a `std::vector<curlio::detail::asio_error_code>` depending
+	 * on `token`.
+	 */
+	template<typename Token>
+	auto async_fill_form(std::vector<FormAction> actions, Token&& token);
 
 	template<typename Token>
 	auto async_execute_script_sync(std::string_view script, Token&& token);
+	/// Like `async_execute_script_sync()` with its own maximum response size. See `async_get_page_source()`.
+	template<typename Token>
+	auto async_execute_script_sync(std::string_view script, std::size_t max_response_size, Token&& token);
 	template<typename Token>
 	auto async_execute_script_async(std::string_view script, nlohmann::json arguments, Token&& token);
+	/// Like `async_execute_script_async()` with its own maximum response size. See `async_get_page_source()`.
+	template<typename Token>
+	auto async_execute_script_async(std::string_view script, nlohmann::json arguments,
+	                                std::size_t max_response_size, Token&& token);
+	/**
+	 * Executes a prepared script. The script is installed into the current document with the first call and
+	 * afterwards only invoked by its ID. If the document changed in the meantime, the script is reinstalled
+	 * within the same call.
+	 *
+	 * @param script The prepared script.
+	 * @param arguments The positional arguments for the parameters of `script`.
+	 * @param token The ASIO completion token.
+	 * @return The result of the script as `nlohmann::json` depending on `token`.
+	 */
+	template<typename Token>
+	auto async_execute_prepared_script(const PreparedScript& script, nlohmann::json::array_t arguments,
+	                                   Token&& token);
+
+	/**
+	 * Serializes the whole document into a `DomSnapshot` with a single script call. The snapshot can be queried
+	 * locally with CSS selectors and XPath which saves a round-trip for every lookup and read.
+	 *
+	 * @param options The snapshot options.
+	 * @param token The ASIO completion token.
+	 * @return The result stored in a `DomSnapshot` depending on `token`.
+	 */
+	template<typename Token>
+	auto async_snapshot_dom(DomSnapshot::Options options, Token&& token) const;
+	/**
+	 * Serializes the subtree of `root` into a `DomSnapshot` with a single script call.
+	 *
+	 * @param root The root element of the snapshot.
+	 * @param options The snapshot options.
+	 * @param token The ASIO completion token.
+	 * @return The result stored in a `DomSnapshot` depending on `token`.
+	 */
+	template<typename Token>
+	auto async_snapshot_dom(const Element& root, DomSnapshot::Options options, Token&& token) const;
+
+	/**
+	 * Executes a Chrome DevTools Protocol command. This is only supported by Chromium based browsers.
+	 *
+	 * @param command The command name, for example `Network.setCookies`.
+	 * @param parameters The command parameters as object.
+	 * @param token The ASIO completion token.
+	 * @return The command result as `nlohmann::json` depending on `token`.
+	 */
+	template<typename Token>
+	auto async_execute_cdp(std::string_view command, nlohmann::json parameters, Token&& token);
+	/**
+	 * Waits until the page stops loading data instead of sleeping for a fixed time after navigating. Running
+	 * `fetch()` and `XMLHttpRequest` calls are counted by hooks which are installed into the document with the
+	 * first call; requests started before that are only noticed once they finish. The whole wait is done by a
+	 * single asynchronous script, so the deadline must stay below the script timeout of the session.
+	 *
+	 * @param quiet_period How long no request may start or finish.
+	 * @param max_in_flight The number of requests which may keep running, e.g. long-polling connections.
+	 * @param deadline Gives up after this time.
+	 * @param token The ASIO completion token.
+	 * @return Whether the network became idle before the deadline stored in a `bool` depending on `token`.
+	 */
+	template<typename Token>
+	auto async_wait_for_network_idle(std::chrono::steady_clock::duration quiet_period,
+	                                 std::size_t max_in_flight, std::chrono::steady_clock::duration deadline,
+	                                 Token&& token);
+	/**
+	 * Waits until the page stops changing visually. The document is sampled every animation frame and is
+	 * stable once neither the DOM nor its size changed and all fonts are loaded for `quiet_period`. Like
+	 * `async_wait_for_network_idle()`, the deadline must stay below the script timeout of the session.
+	 *
+	 * @param quiet_period How long the document must stay unchanged.
+	 * @param deadline Gives up after this time.
+	 * @param token The ASIO completion token.
+	 * @return Whether the page became stable before the deadline stored in a `bool` depending on `token`.
+	 */
+	template<typename Token>
+	auto async_wait_for_render_stable(std::chrono::steady_clock::duration quiet_period,
+	                                  std::chrono::steady_clock::duration deadline, Token&& token);
+	/**
+	 * Navigates to the URL, waits until the page is ready and runs an extraction script. Waiting and extracting
+	 * happen in a single asynchronous script, so this takes two round trips instead of one per step. The
+	 * readiness deadline must stay below the script timeout of the session. If the deadline passes, the script
+	 * still extracts and the result is marked as not ready.
+	 *
+	 * @param url The fully qualified URL.
+	 * @param script The body of the extraction function. It may return a promise.
+	 * @param arguments The arguments passed to `script`.
+	 * @param options When the page counts as ready.
+	 * @param token The ASIO completion token.
+	 * @return The extracted value and the timings stored in an `ExtractResult` depending on `token`.
+	 */
+	template<typename Token>
+	auto async_navigate_and_extract(std::string url, std::string_view script, nlohmann::json::array_t arguments,
+	                                ExtractOptions options, Token&& token);
+	/**
+	 * Captures the whole page including the parts outside of the viewport. The page is captured in tiles of
+	 * `FullPageScreenshotOptions::tile_height` which are decoded and written to disk on
+	 * `FullPageScreenshotOptions::file_executor`, so memory stays bounded by the tile size instead of the page
+	 * size. If the page needs more than one tile, every tile
+	 * is written to its own file where `-<index>` is inserted before the extension of `path`. This uses the
+	 * Chrome DevTools Protocol and is only supported by Chromium based browsers.
+	 *
+	 * @param path The image file.
+	 * @param options The capture options.
+	 * @param token The ASIO completion token.
+	 * @return The written tiles from top to bottom stored in a `std::vector<ScreenshotTile>` depending on
+	 * `token`.
+	 */
+	template<typename Token>
+	auto async_take_full_page_screenshot(std::string path, FullPageScreenshotOptions options, Token&& token);
+
+	/**
+	 * Retrieves all cookies visible to the current page.
+	 *
+	 * @param token The ASIO completion token.
+	 * @return The result stored in a `std::vector<Cookie>` depending on `token`.
+	 */
+	template<typename Token>
+	auto async_get_cookies(Token&& token) const;
+	/**
+	 * Retrieves the cookie with the given name.
+	 *
+	 * @param name The cookie name.
+	 * @param token The ASIO completion token.
+	 * @return The result stored in a `std::optional<Cookie>` depending on `token`.
+	 */
+	template<typename Token>
+	auto async_get_cookie(std::string_view name, Token&& token) const;
+	/**
+	 * Adds a cookie to the current page's domain.
+	 *
+	 * @param cookie The cookie.
+	 * @param token The ASIO completion token.
+	 */
+	template<typename Token>
+	auto async_add_cookie(const Cookie& cookie, Token&& token);
+	template<typename Token>
+	auto async_delete_cookie(std::string_view name, Token&& token);
+	template<typename Token>
+	auto async_delete_all_cookies(Token&& token);
+
+	/**
+	 * Captures the cookies and the local and session storage of the current page in two requests.
+	 *
+	 * @param token The ASIO completion token.
+	 * @return The result stored in a `SessionState` depending on `token`.
+	 */
+	template<typename Token>
+	auto async_capture_state(Token&& token);
+	/**
+	 * Restores a state captured by `async_capture_state()`. On Chromium based browsers the cookies are set with
+	 * a DevTools command. A non-empty storage is applied by a script that runs before the page's scripts while
+	 * navigating to the state's URL; the script is removed again afterwards. Other browsers navigate to the
+	 * state's URL and set the storage and every cookie separately; the page has to be reloaded afterwards.
+	 *
+	 * The storage restoration on Chromium marks the session storage with the key `__wdlite_restored`.
+	 *
+	 * @param state The state to restore.
+	 * @param token The ASIO completion token.
+	 */
+	template<typename Token>
+	auto async_restore_state(SessionState state, Token&& token);
+
+	/**
+	 * Retrieves the handle of the current window.
+	 *
+	 * @param token The ASIO completion token.
+	 * @return The result stored in a `std::string` depending on `token`.
+	 */
+	template<typename Token>
+	auto async_get_window_handle(Token&& token) const;
+	/**
+	 * Retrieves the handles of all open windows.
+	 *
+	 * @param token The ASIO completion token.
+	 * @return The result stored in a `std::vector<std::string>` depending on `token`.
+	 */
+	template<typename Token>
+	auto async_get_window_handles(Token&& token) const;
+	/**
+	 * Opens a new window or tab. The current window is not changed.
+	 *
+	 * @param type The preferred type. The remote end may choose the other one.
+	 * @param token The ASIO completion token.
+	 * @return The handle of the new window stored in a `std::string` depending on `token`.
+	 */
+	template<typename Token>
+	auto async_new_window(WindowType type, Token&& token);
+	/**
+	 * Makes the given window the current window.
+	 *
+	 * @param handle The window handle.
+	 * @param token The ASIO completion token.
+	 */
+	template<typename Token>
+	auto async_switch_to_window(std::string_view handle, Token&& token);
+	/**
+	 * Closes the current window. Closing the last window deletes the remote session.
+	 *
+	 * @param token The ASIO completion token.
+	 * @return The handles of the remaining windows stored in a `std::vector<std::string>` depending on `token`.
+	 */
+	template<typename Token>
+	auto async_close_window(Token&& token);
+
+	/**
+	 * Performs the whole action sequence of all input sources in a single request.
+	 *
+	 * @param actions The actions. See `wdlite::Actions` for more information.
+	 * @param token The ASIO completion token.
+	 */
+	template<typename Token>
+	auto async_perform_actions(const Actions& actions, Token&& token);
+	/**
+	 * Releases all keys and pointer buttons which are currently pressed.
+	 *
+	 * @param token The ASIO completion token.
+	 */
+	template<typename Token>
+	auto async_release_actions(Token&& token);
 
 private:
 	friend Element;
+	friend WindowMultiplexer;
 
 	std::shared_ptr<curlio::Session> _session;
-	std::string _endpoint;
+	/// Shared with the running requests because they may outlive this instance.
+	std::shared_ptr<detail::CommandQueue> _queue;
+	/// Shared with the running requests because they may outlive this instance.
+	std::shared_ptr<detail::LocatorCache> _locator_cache;
+	/// Shared with the running requests because they may outlive this instance.
+	std::shared_ptr<detail::SessionCounters> _counters;
+	std::shared_ptr<Endpoint> _endpoint;
 	std::string _session_id;
+	Ownership _ownership = Ownership::owning;
+	/// The default of all commands. `0` means no limit.
+	std::size_t _max_response_size = 0;
 	/// A precomputed prefix string for the session endpoints.
 	std::string _prefix;
+	/// The handle of the current window if known.
+	std::string _window_handle;
+	/// The IDs of the prepared scripts which are probably installed in the current document.
+	std::unordered_set<std::string> _installed_scripts;
 
 	/// Just instantiates the object but does not create the remote session.
-	Session(executor_type executor, std::string endpoint);
+	Session(executor_type executor, std::shared_ptr<Endpoint> endpoint);
 
 	template<typename Token, typename Lambda>
-	auto _get(const std::string& endpoint, Token&& token, Lambda&& lambda) const;
+	auto _get(std::string endpoint, Token&& token, Lambda&& lambda, std::size_t max_response_size = 0) const;
 	template<typename Token, typename Lambda>
-	auto _post(const std::string& endpoint, const nlohmann::json& payload, Token&& token, Lambda&& lambda) const;
+	auto _post(std::string endpoint, const nlohmann::json& payload, Token&& token, Lambda&& lambda,
+	           detail::Access access = detail::Access::write, std::size_t max_response_size = 0) const;
 	template<typename Token, typename Lambda>
-	auto _delete(const std::string& endpoint, Token&& token, Lambda&& lambda);
+	auto _delete(std::string endpoint, Token&& token, Lambda&& lambda);
+	/// Resolves the limit of a single command. See `async_get_page_source()`.
+	std::size_t _resolve_max_response_size(std::size_t max_response_size) const noexcept;
+	/// Wraps the lambda of a request to clear the locator cache if the response reports a stale element.
+	template<typename Lambda>
+	auto _watch_staleness(Lambda&& lambda) const;
+	/// Starts tile captures until the parallel limit is reached and wakes up the waiter once all finished.
+	void _capture_tiles(std::shared_ptr<detail::FullPageCapture> capture) const;
+	template<typename Token>
+	auto _async_snapshot_dom(nlohmann::json root, DomSnapshot::Options options, Token&& token) const;
 	template<typename Token>
 	auto _async_find_element(const std::string& endpoint, std::string_view selector, LocatorStrategy strategy,
 	                         Token&& token) const;
@@ -114,4 +514,29 @@ private:
 	                          Token&& token) const;
 };
 
+/// Like the friend declared in `Session` but creates a new `Endpoint` for the URL.
+template<typename Token>
+auto async_new_session(Session::executor_type executor, std::string endpoint, nlohmann::json capabilities,
+                       Token&& token);
+/// Like the friend declared in `Session` but creates a new `Endpoint` for the URL.
+template<typename Token>
+auto async_attach_session(Session::executor_type executor, std::string endpoint, std::string session_id,
+                          Ownership ownership, Token&& token);
+/**
+ * Closes many sessions concurrently with `Session::async_close()`. At most `CloseAllOptions::max_parallel`
+ * sessions are closed at once and the operation completes once all are closed or the deadline passed,
+ * whichever comes first. Sessions which did not start closing before the deadline are not closed anymore
+ * but keep their ownership, so their destructors still delete them with a detached request. Demote them with
+ * `Session::set_ownership()` to keep them alive. The sessions may run on other executors.
+ *
+ * @param executor The executor of the deadline timer. The bookkeeping runs on a strand of it.
+ * @param sessions The sessions to close.
+ * @param options The fan-out and deadline.
+ * @param token The ASIO completion token.
+ * @return The result stored in a `CloseReport` depending on `token`.
+ */
+template<typename Token>
+auto async_close_all(Session::executor_type executor, std::vector<std::shared_ptr<Session>> sessions,
+                     CloseAllOptions options, Token&& token);
+
 } // namespace wdlite
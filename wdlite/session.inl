@@ -1,32 +1,44 @@
+#pragma once
+
+#include "actions.hpp"
 #include "element.hpp"
+#include "endpoint.hpp"
 #include "error.hpp"
+#include "form.hpp"
+#include "locator.hpp"
 #include "log.hpp"
+#include "request.hpp"
+#include "script.hpp"
+#include "state.hpp"
 #include "session.hpp"
 
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
 #include <type_traits>
 #include <utility>
-#include <variant>
 
 namespace wdlite {
 
 namespace detail {
 
-template<typename Token, typename Lambda>
-inline void complete_token(Token&& token, Lambda&& lambda, curlio::detail::asio_error_code ec,
-                           nlohmann::json&& json)
+template<typename Handler, typename Lambda>
+inline void complete_handler(Handler& handler, Lambda& lambda, curlio::detail::asio_error_code ec,
+                             nlohmann::json&& json)
 {
 	using type = decltype(lambda(ec, std::move(json)));
 	if constexpr (std::is_void_v<type>) {
 		if (!ec) {
 			lambda(ec, std::move(json));
 		}
-		token.complete(ec);
+		std::move(handler)(ec);
 	} else {
 		if (ec) {
-			token.complete(ec, type{});
+			std::move(handler)(ec, type{});
 		} else {
 			auto value = lambda(ec, std::move(json));
-			token.complete(ec, std::move(value));
+			std::move(handler)(ec, std::move(value));
 		}
 	}
 }
@@ -47,6 +59,156 @@ inline std::size_t formatted_argument_list_size(const nlohmann::json& args) noex
 	return size;
 }
 
+/// Collects the URL, the origin and the storage of the current page.
+constexpr std::string_view capture_state_script =
+  "const d=s=>{const r={};for(let i=0;i<s.length;++i){const k=s.key(i);"
+  "if(k!=='__wdlite_restored')r[k]=s.getItem(k);}return r;};"
+  "return {url:location.href,origin:location.origin,local:d(localStorage),session:d(sessionStorage)};";
+
+/**
+ * Serializes the subtree of `arguments[0]` (or the document) into a string table and a node stream. Elements
+ * are encoded as `1,tag,attribute count,(name,value)*,visible,child count` and text nodes as `3,text` in
+ * document order. Whitespace-only text nodes, comments and other nodes are skipped.
+ */
+constexpr std::string_view snapshot_dom_script =
+  R"(const r=arguments[0]||document.documentElement,v=arguments[1],s=[],m=new Map(),n=[];)"
+  R"(const i=x=>{let k=m.get(x);if(k===undefined){k=s.length;m.set(x,k);s.push(x);}return k;};)"
+  R"(const w=e=>{if(e.nodeType===3){if(!/\S/.test(e.data))return 0;n.push(3,i(e.data));return 1;})"
+  R"(if(e.nodeType!==1)return 0;n.push(1,i(e.localName),e.attributes.length);)"
+  R"(for(const a of e.attributes)n.push(i(a.name),i(a.value));)"
+  R"(n.push(!v?1:(e.checkVisibility?e.checkVisibility({checkOpacity:true,checkVisibilityCSS:true}))"
+  R"(:!!(e.offsetWidth||e.offsetHeight||e.getClientRects().length))?1:0);)"
+  R"(const p=n.length;n.push(0);let c=0;for(let x=e.firstChild;x;x=x.nextSibling)c+=w(x);n[p]=c;return 1;};)"
+  R"(w(r);return [s.join('\0'),n.join(',')];)";
+
+/**
+ * Counts the running `fetch()` and `XMLHttpRequest` calls of the document and tracks the end of the last
+ * resource load. Completes with `true` once the document is loaded, at most `arguments[1]` requests are
+ * running and nothing happened for `arguments[0]` ms or with `false` after `arguments[2]` ms.
+ */
+constexpr std::string_view network_idle_script =
+  R"(const[q,x,t,c]=arguments,w=window,p=performance;let n=w.__wdlite_network;)"
+  R"(if(!n){n=w.__wdlite_network={active:0,last:0};)"
+  R"(const a=()=>{++n.active;n.last=p.now();},e=()=>{--n.active;n.last=p.now();};)"
+  R"(for(const r of p.getEntriesByType('resource'))n.last=Math.max(n.last,r.responseEnd);)"
+  R"(const f=w.fetch;if(f)w.fetch=function(){a();return f.apply(this,arguments).finally(e);};)"
+  R"(const s=XMLHttpRequest.prototype.send;XMLHttpRequest.prototype.send=function(){a();)"
+  R"(this.addEventListener('loadend',e,{once:true});try{return s.apply(this,arguments);})"
+  R"(catch(r){this.removeEventListener('loadend',e);e();throw r;}};)"
+  R"(try{new PerformanceObserver(l=>{for(const r of l.getEntries())n.last=Math.max(n.last,r.responseEnd);}))"
+  R"(.observe({type:'resource'});}catch(r){}})"
+  R"(const d=p.now()+t;(function o(){const m=p.now();)"
+  R"(if(document.readyState==='complete'&&n.active<=x&&m-n.last>=q)c(true);else if(m>=d)c(false);)"
+  R"(else setTimeout(o,Math.max(10,Math.min(50,q/4)));})();)";
+
+/**
+ * Samples the document every animation frame. Completes with `true` once neither the DOM nor the size of the
+ * document changed and all fonts are loaded for `arguments[0]` ms or with `false` after `arguments[1]` ms.
+ * The timeout keeps sampling if animation frames are throttled, e.g. in background tabs.
+ */
+constexpr std::string_view render_stable_script =
+  R"(const[q,t,c]=arguments,d=document,p=performance,e=p.now()+t;let l=p.now(),s='',u=false;)"
+  R"(const o=new MutationObserver(()=>{u=true;});)"
+  R"(o.observe(d,{subtree:true,childList:true,attributes:true,characterData:true});)"
+  R"(const k=()=>{const m=p.now(),r=d.documentElement,g=r?r.scrollWidth+'x'+r.scrollHeight:'';)"
+  R"(if(u||g!==s||(d.fonts&&d.fonts.status!=='loaded')){u=false;s=g;l=m;})"
+  R"(if(m-l>=q&&d.readyState!=='loading'){o.disconnect();c(true);})"
+  R"(else if(m>=e){o.disconnect();c(false);}else n();};)"
+  R"(const n=()=>{let h=false;const g=()=>{if(!h){h=true;k();}};)"
+  R"(requestAnimationFrame(g);setTimeout(g,100);};n();)";
+
+/**
+ * Creates an asynchronous script which waits for the readiness condition of `options` and then calls
+ * `script` with the arguments `arguments[0]`. Completes with `{value, ready, wait, extract, timing}` where
+ * the durations are in ms or with `{failure}` if the extraction failed. Not `error` which would be taken for
+ * a WebDriver error.
+ */
+inline std::string make_extract_script(std::string_view script, const ExtractOptions& options)
+{
+	std::string result = "const[a,q,x,t,c]=arguments,p=performance,s=p.now();const E=function(){";
+	result.append(script);
+	result += "};const F=r=>{const w=p.now();Promise.resolve().then(()=>E.apply(null,a)).then(v=>{"
+	          "const n=p.getEntriesByType('navigation')[0];c({value:v===undefined?null:v,ready:r,wait:w-s,"
+	          "extract:p.now()-w,timing:n?[n.responseStart,n.domContentLoadedEventEnd,n.loadEventEnd]:null});},"
+	          "e=>c({failure:String(e&&e.stack||e)}));};";
+	switch (options.readiness) {
+	case ExtractOptions::Readiness::load: result += "F(true);"; break;
+	case ExtractOptions::Readiness::network_idle:
+		result += "(function(){";
+		result.append(network_idle_script);
+		result += "})(q,x,t,F);";
+		break;
+	case ExtractOptions::Readiness::render_stable:
+		result += "(function(){";
+		result.append(render_stable_script);
+		result += "})(q,t,F);";
+		break;
+	case ExtractOptions::Readiness::condition:
+		result += "const W=function(){";
+		result += options.condition;
+		result += "},d=s+t;(function o(){Promise.resolve().then(W).catch(()=>false).then(v=>{"
+		          "if(v)F(true);else if(p.now()>=d)F(false);else setTimeout(o,50);});})();";
+		break;
+	}
+	return result;
+}
+
+/// Creates a script which restores the storage of `state` if it is evaluated in a document of its origin.
+inline std::string make_restore_storage_script(const SessionState& state)
+{
+	const nlohmann::json storage{ { "origin", state.origin },
+		                            { "local", state.local_storage },
+		                            { "session", state.session_storage } };
+	return "(function(s){if(location.origin!==s.origin)return;try{"
+	       "if(sessionStorage.getItem('__wdlite_restored'))return;"
+	       "for(const[k,v]of Object.entries(s.local))localStorage.setItem(k,v);"
+	       "for(const[k,v]of Object.entries(s.session))sessionStorage.setItem(k,v);"
+	       "sessionStorage.setItem('__wdlite_restored','1');}catch(e){}})(" +
+	       storage.dump() + ");";
+}
+
+/// Converts the cookie to a parameter for the DevTools command `Network.setCookies`.
+inline nlohmann::json make_cdp_cookie(const Cookie& cookie, const std::string& url)
+{
+	nlohmann::json json{
+		{ "name", cookie.name },
+		{ "value", cookie.value },
+		{ "path", cookie.path.empty() ? std::string{ "/" } : cookie.path },
+		{ "secure", cookie.secure },
+		{ "httpOnly", cookie.http_only },
+	};
+	if (cookie.domain.empty()) {
+		json["url"] = url;
+	} else {
+		json["domain"] = cookie.domain;
+	}
+	if (cookie.expiry.has_value()) {
+		json["expires"] = cookie.expiry.value();
+	}
+	if (!cookie.same_site.empty()) {
+		json["sameSite"] = cookie.same_site;
+	}
+	return json;
+}
+
+/// Percent-encodes everything but the unreserved characters so that the value stays a single path segment.
+inline std::string encode_path_segment(std::string_view segment)
+{
+	std::string encoded{};
+	encoded.reserve(segment.size());
+	for (const auto c : segment) {
+		if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '.' ||
+		    c == '_' || c == '~') {
+			encoded += c;
+		} else {
+			encoded += '%';
+			encoded += "0123456789ABCDEF"[static_cast<unsigned char>(c) >> 4];
+			encoded += "0123456789ABCDEF"[static_cast<unsigned char>(c) & 0xf];
+		}
+	}
+	return encoded;
+}
+
 constexpr std::string_view strategy_to_string(LocatorStrategy strategy) noexcept
 {
 	switch (strategy) {
@@ -59,14 +221,19 @@ constexpr std::string_view strategy_to_string(LocatorStrategy strategy) noexcept
 	return "";
 }
 
-inline bool check_error(curlio::detail::asio_error_code& ec, const nlohmann::json& response)
+/**
+ * Converts the error of the WebDriver in `response` into `ec`. Besides objects and arrays a `value` of type
+ * `result_type` is accepted, which defaults to `null` for commands without a result.
+ */
+inline bool check_error(curlio::detail::asio_error_code& ec, const nlohmann::json& response,
+                        nlohmann::json::value_t result_type = nlohmann::json::value_t::null)
 {
 	if (ec) {
 		return false;
 	} else if (const auto vit = response.find("value");
-	           vit == response.end() || !(vit->is_object() || vit->is_array())) {
+	           vit == response.end() || !(vit->is_object() || vit->is_array() || vit->type() == result_type)) {
 		ec = Code::unknown_webdirver_error;
-	} else if (vit->is_array()) {
+	} else if (!vit->is_object()) {
 		return true;
 	} else if (const auto eit = vit->find("error"); eit != vit->end() && eit->is_string()) {
 		ec = convert_webdriver_error(eit->get_ref<const std::string&>());
@@ -76,6 +243,50 @@ inline bool check_error(curlio::detail::asio_error_code& ec, const nlohmann::jso
 	return false;
 }
 
+inline bool is_stale_element_response(const nlohmann::json& response) noexcept
+{
+	const auto vit = response.find("value");
+	if (vit == response.end() || !vit->is_object()) {
+		return false;
+	}
+	const auto eit = vit->find("error");
+	return eit != vit->end() && eit->is_string() &&
+	       convert_webdriver_error(eit->get_ref<const std::string&>()) == Code::stale_element_reference;
+}
+
+/// The ID of the element or shadow root reference or an empty string if `reference` is something else.
+inline std::string get_reference_id(const nlohmann::json& reference, std::string_view key)
+{
+	if (!reference.is_object()) {
+		return {};
+	}
+	const auto it = reference.find(key);
+	return it != reference.end() && it->is_string() ? it->get<std::string>() : std::string{};
+}
+
+inline std::string make_locator_key(std::string_view endpoint, LocatorStrategy strategy,
+                                    std::string_view selector)
+{
+	return make_keys(endpoint, "\n", strategy_to_string(strategy), "\n", selector);
+}
+
+/// Completes the token with the values through the executor, i.e. never from within the initiating function.
+template<typename Signature, typename Executor, typename Token, typename... Values>
+inline auto async_post_completion(Executor executor, Token&& token, Values... values)
+{
+	return CURLIO_ASIO_NS::async_compose<Token, Signature>(
+	  [executor, values = std::make_tuple(std::move(values)...), posted = false](
+	    auto& self, auto&&... /* ignored */) mutable {
+		  if (!posted) {
+			  posted = true;
+			  CURLIO_ASIO_NS::post(executor, std::move(self));
+			  return;
+		  }
+		  std::apply([&](auto&... value) { self.complete(std::move(value)...); }, values);
+	  },
+	  token, executor);
+}
+
 template<typename Lambda>
 constexpr auto derive_asio_signature() noexcept
 {
@@ -93,85 +304,215 @@ using AsioSignature = typename decltype(derive_asio_signature<Lambda>())::type;
 
 /**
  * Performs the WebDriver request for the given endpoint. This is just the generic implementation for
- * `_get()`, `_post()` and `_delete()`.
+ * `_get()`, `_post()` and `_delete()`. Only the completion is adapted to the token here; the request
+ * itself is done by `start_request()`.
  *
  * @param session The cURLio session. The session will be kept alive as long as the request is running.
- * @param endpoint The full WebDriver URL.
+ * @param endpoint The remote endpoint. If it has a replayer, the response is taken from the tape instead. If
+ * it has a limiter, the request also waits for a slot of it.
+ * @param queue The command queue of the session. The request waits until the queue allows it to start.
+ * @param counters The counters of the session. May be null.
+ * @param access Whether the command only reads or may change the browser state.
+ * @param command The command relative to the endpoint URL.
  * @param token The ASIO completion token.
  * @param lambda This lambda will receive the JSON response from the WebDriver. The result of this lambda
  * will be forwarded to the completion token. The signature is `<return>(curlio::detail::asio_error_code&,
  * nlohmann::json)`.
- * @param modifier This modifier will be called once before the request starts. This instance will be kept
- * alive. The signature is `void(curlio::Request&)`.
  */
-template<typename Token, typename Lambda, typename RequestModifier>
-auto perform_request(std::shared_ptr<curlio::Session> session, const std::string& endpoint, Token&& token,
-                     Lambda&& lambda, RequestModifier&& modifier)
-{
-	auto executor = session->get_executor();
-	auto request = curlio::make_request(session);
-	request->set_option<CURLOPT_URL>(endpoint.c_str());
-	// request->set_option<CURLOPT_VERBOSE>(true);
-
-	return CURLIO_ASIO_NS::async_compose<Token, detail::AsioSignature<Lambda>>(
-	  [session = std::move(session), lambda = std::forward<Lambda>(lambda),
-	   modifier = std::forward<RequestModifier>(modifier), request = std::move(request),
-	   response = curlio::Session::response_pointer{}](
-	    auto& self, curlio::detail::asio_error_code ec = {},
-	    std::variant<std::monostate, curlio::Session::response_pointer, std::string> result = {}) mutable {
-		  // Any error is a bad error.
-		  if (ec) {
-			  detail::complete_token(self, lambda, ec, {});
-			  return;
-		  }
-
-		  switch (result.index()) {
-			// Initiate composition by starting the request.
-		  case 0: {
-			  modifier(*request);
-			  session->async_start(request, std::move(self));
-			  break;
-		  }
-			// Request was started now read the response.
-		  case 1: {
-			  response = std::get<1>(std::move(result));
-			  curlio::quick::async_read_all(response, std::move(self));
-			  break;
-		  }
-			// Response was received now finish up.
-		  case 2:
-			  WDLITE_DEBUG("Result: " << std::get<2>(result));
-			  detail::complete_token(self, lambda, ec, nlohmann::json::parse(std::get<2>(result)));
-			  break;
-		  }
+template<typename Token, typename Lambda>
+auto perform_request(std::shared_ptr<curlio::Session> session, std::shared_ptr<Endpoint> endpoint,
+                     std::shared_ptr<CommandQueue> queue, std::shared_ptr<SessionCounters> counters,
+                     Access access, Command command, Token&& token, Lambda&& lambda)
+{
+	return CURLIO_ASIO_NS::async_initiate<Token, detail::AsioSignature<Lambda>>(
+	  [](auto handler, std::shared_ptr<curlio::Session> session, std::shared_ptr<Endpoint> endpoint,
+	     std::shared_ptr<CommandQueue> queue, std::shared_ptr<SessionCounters> counters, Access access,
+	     Command command, auto lambda) {
+		  // Like a composed operation, the handler is invoked through its associated executor.
+		  auto work = CURLIO_ASIO_NS::make_work_guard(
+		    CURLIO_ASIO_NS::get_associated_executor(handler, session->get_executor()));
+		  start_request(std::move(session), std::move(endpoint), std::move(queue), std::move(counters), access,
+		                std::move(command),
+		                [handler = std::move(handler), lambda = std::move(lambda), work = std::move(work)](
+		                  curlio::detail::asio_error_code ec, nlohmann::json response) mutable {
+			                const auto executor = work.get_executor();
+			                CURLIO_ASIO_NS::dispatch(executor, [handler = std::move(handler),
+			                                                    lambda = std::move(lambda), ec,
+			                                                    response = std::move(response)]() mutable {
+				                detail::complete_handler(handler, lambda, ec, std::move(response));
+			                });
+			                work.reset();
+		                });
 	  },
-	  token, std::move(executor));
+	  token, std::move(session), std::move(endpoint), std::move(queue), std::move(counters), access,
+	  std::move(command), std::forward<Lambda>(lambda));
 }
 
+/// The shared state of `async_close_all()`.
+struct CloseAll {
+	std::vector<std::shared_ptr<Session>> sessions;
+	std::size_t max_parallel;
+	/// The index of the next session to close.
+	std::size_t next = 0;
+	std::size_t running = 0;
+	std::vector<bool> finished;
+	/// Set once the operation completed. Later results are ignored.
+	bool completed = false;
+	CloseReport report;
+	/// Expires at the deadline or once all sessions are closed. Runs on a strand which every access to this
+	/// state goes through because the sessions may complete on other executors.
+	CURLIO_ASIO_NS::steady_timer timer;
+};
+
+/// The shared state of `Session::async_get_browser_metrics()`.
+struct BrowserMetricsQuery {
+	BrowserMetrics metrics;
+	curlio::detail::asio_error_code error;
+	std::size_t remaining;
+	/// Expires once all commands answered.
+	CURLIO_ASIO_NS::steady_timer timer;
+};
+
 } // namespace detail
 
 inline Session::executor_type Session::get_executor() const noexcept { return _session->get_executor(); }
 
 inline const std::string& Session::get_id() const noexcept { return _session_id; }
 
-inline Session::Session(executor_type executor, std::string endpoint) : _endpoint{ std::move(endpoint) }
+inline const std::shared_ptr<Endpoint>& Session::get_endpoint() const noexcept { return _endpoint; }
+
+inline Ownership Session::get_ownership() const noexcept { return _ownership; }
+
+inline void Session::set_ownership(Ownership ownership) noexcept { _ownership = ownership; }
+
+inline void Session::set_max_in_flight(std::size_t max_in_flight)
 {
+	_queue->set_max_in_flight(max_in_flight);
+}
+
+inline std::size_t Session::get_max_in_flight() const noexcept { return _queue->get_max_in_flight(); }
+
+inline QueueStatistics Session::get_queue_statistics() const noexcept { return _queue->get_statistics(); }
+
+inline void Session::set_max_response_size(std::size_t max_response_size) noexcept
+{
+	_max_response_size = max_response_size;
+}
+
+inline std::size_t Session::get_max_response_size() const noexcept { return _max_response_size; }
+
+inline SessionStatistics Session::get_statistics() const noexcept { return _counters->get_statistics(); }
+
+template<typename Token>
+inline auto Session::async_get_browser_metrics(Token&& token) const
+{
+	using time_point = CURLIO_ASIO_NS::steady_timer::time_point;
+
+	auto state = std::make_shared<detail::BrowserMetricsQuery>(detail::BrowserMetricsQuery{
+	  {}, {}, 2, CURLIO_ASIO_NS::steady_timer{ get_executor(), time_point::max() } });
+
+	return CURLIO_ASIO_NS::async_compose<Token, void(curlio::detail::asio_error_code, BrowserMetrics)>(
+	  [session = shared_from_this(), state = std::move(state),
+	   started = false](auto& self, curlio::detail::asio_error_code /* ec */ = {}) mutable {
+		  if (started) {
+			  self.complete(state->error, state->error ? BrowserMetrics{} : state->metrics);
+			  return;
+		  }
+
+		  started = true;
+		  const auto query = [&](std::string_view command, auto apply) {
+			  session->_post(
+			    session->_prefix + "/goog/cdp/execute",
+			    nlohmann::json{ { "cmd", command }, { "params", nlohmann::json::object() } },
+			    [state, apply](curlio::detail::asio_error_code ec, nlohmann::json value) {
+				    if (ec) {
+					    state->error = ec;
+				    } else if (value.is_object()) {
+					    apply(state->metrics, value);
+				    }
+				    if (--state->remaining == 0) {
+					    state->timer.expires_at(time_point::min());
+				    }
+			    },
+			    [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+				    if (detail::check_error(ec, response)) {
+					    return std::move(response["value"]);
+				    }
+				    return nlohmann::json{};
+			    },
+			    detail::Access::read);
+		  };
+		  query("Memory.getDOMCounters", [](BrowserMetrics& metrics, const nlohmann::json& value) {
+			  metrics.documents = value.value("documents", std::size_t{ 0 });
+			  metrics.nodes = value.value("nodes", std::size_t{ 0 });
+			  metrics.event_listeners = value.value("jsEventListeners", std::size_t{ 0 });
+		  });
+		  query("Runtime.getHeapUsage", [](BrowserMetrics& metrics, const nlohmann::json& value) {
+			  metrics.js_heap_used = value.value("usedSize", std::uint64_t{ 0 });
+			  metrics.js_heap_total = value.value("totalSize", std::uint64_t{ 0 });
+		  });
+		  state->timer.async_wait(std::move(self));
+	  },
+	  token, get_executor());
+}
+
+inline void Session::set_locator_cache_enabled(bool enabled) { _locator_cache->set_enabled(enabled); }
+
+inline bool Session::is_locator_cache_enabled() const noexcept { return _locator_cache->is_enabled(); }
+
+inline void Session::clear_locator_cache() noexcept { _locator_cache->invalidate(); }
+
+inline LocatorCacheStatistics Session::get_locator_cache_statistics() const noexcept
+{
+	return _locator_cache->get_statistics();
+}
+
+inline const std::string& Session::detach() noexcept
+{
+	_ownership = Ownership::borrowed;
+	return _session_id;
+}
+
+inline Session::Session(executor_type executor, std::shared_ptr<Endpoint> endpoint)
+    : _endpoint{ std::move(endpoint) }
+{
+	_endpoint->_sessions.fetch_add(1, std::memory_order_relaxed);
 	_session = curlio::make_session(std::move(executor));
+	_queue = std::make_shared<detail::CommandQueue>(4);
+	_locator_cache = std::make_shared<detail::LocatorCache>();
+	_counters = std::make_shared<detail::SessionCounters>();
+}
 
-	if (!_endpoint.empty() && _endpoint.back() != '/') {
-		_endpoint.push_back('/');
-	}
+template<typename Token>
+inline auto Session::async_close(Token&& token)
+{
+	return CURLIO_ASIO_NS::async_initiate<Token, void(curlio::detail::asio_error_code)>(
+	  [](auto handler, std::shared_ptr<Session> session) {
+		  // Both paths start a single operation so that every token sees the same initiation.
+		  if (session->_session_id.empty()) {
+			  detail::async_post_completion<void(curlio::detail::asio_error_code)>(
+			    session->get_executor(), std::move(handler), curlio::detail::asio_error_code{});
+			  return;
+		  }
+		  // The destructor must not delete the session a second time.
+		  session->_ownership = Ownership::borrowed;
+		  session->_delete(session->_prefix, std::move(handler),
+		                   [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+			                   detail::check_error(ec, response);
+		                   });
+	  },
+	  token, shared_from_this());
 }
 
 template<typename Token>
 inline auto Session::async_navigate(std::string_view url, Token&& token)
 {
+	// The new document will not have any scripts installed.
+	_installed_scripts.clear();
+
 	return _post(_prefix + "/url", nlohmann::json{ { "url", url } }, std::forward<Token>(token),
-	             [this](curlio::detail::asio_error_code& ec, nlohmann::json response) {
-		             if (!ec) {
-			             // TODO add checks
-			             // session->_session_id = response["value"]["sessionId"].get<std::string>();
-		             }
+	             [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+		             detail::check_error(ec, response);
 	             });
 }
 
@@ -196,10 +537,18 @@ inline auto Session::async_get_title(Token&& token) const
 template<typename Token>
 inline auto Session::async_get_page_source(Token&& token) const
 {
-	return _get(_prefix + "/source", std::forward<Token>(token),
-	            [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
-		            return std::move(response["value"].get_ref<std::string&>());
-	            });
+	return async_get_page_source(0, std::forward<Token>(token));
+}
+
+template<typename Token>
+inline auto Session::async_get_page_source(std::size_t max_response_size, Token&& token) const
+{
+	return _get(
+	  _prefix + "/source", std::forward<Token>(token),
+	  [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+		  return std::move(response["value"].get_ref<std::string&>());
+	  },
+	  max_response_size);
 }
 
 template<typename Token>
@@ -216,19 +565,299 @@ inline auto Session::async_find_elements(std::string_view selector, LocatorStrat
 	return _async_find_elements(_prefix + "/elements", selector, strategy, std::forward<Token>(token));
 }
 
+template<typename Token>
+inline auto Session::async_find_element(const Locator& locator, Token&& token)
+{
+	enum class Pending {
+		none,
+		script,
+		native,
+		frame,
+	};
+
+	return CURLIO_ASIO_NS::async_compose<Token, void(curlio::detail::asio_error_code, std::optional<Element>)>(
+	  [session = shared_from_this(), steps = locator.get_steps(), position = std::size_t{ 0 },
+	   segment_end = std::size_t{ 0 }, context = nlohmann::json{}, pending = Pending::none, native = false](
+	    auto& self, curlio::detail::asio_error_code ec = {}, nlohmann::json result = nullptr) mutable {
+		  if (pending == Pending::script && (ec == Code::javascript_error || ec == Code::unknown_command)) {
+			  // Let the native commands report the actual problem like an invalid selector.
+			  ec = {};
+			  native = true;
+		  } else if (ec == Code::no_such_element) {
+			  self.complete(curlio::detail::asio_error_code{}, std::nullopt);
+			  return;
+		  } else if (ec) {
+			  self.complete(ec, std::nullopt);
+			  return;
+		  }
+
+		  switch (pending) {
+		  case Pending::none:
+			  if (steps.empty() || steps.back().kind != Locator::Step::Kind::find) {
+				  self.complete(Code::invalid_argument, std::nullopt);
+				  return;
+			  }
+			  break;
+		  case Pending::script:
+			  if (native) {
+				  break;
+			  } else if (result.is_null()) {
+				  self.complete(ec, std::nullopt);
+				  return;
+			  } else if (result.is_array() && result.size() == 2 && result[0].is_number_unsigned()) {
+				  // The script stopped at a step it cannot perform.
+				  position += result[0].get<std::size_t>();
+				  context = std::move(result[1]);
+				  native = true;
+			  } else {
+				  position = segment_end;
+				  context = std::move(result);
+			  }
+			  break;
+		  case Pending::native:
+			  ++position;
+			  context = std::move(result);
+			  break;
+		  case Pending::frame:
+			  ++position;
+			  context = nullptr;
+			  break;
+		  }
+
+		  const auto value = [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+			  if (detail::check_error(ec, response)) {
+				  return std::move(response["value"]);
+			  }
+			  return nlohmann::json{};
+		  };
+		  const auto element = detail::get_reference_id(context, detail::web_element_identifier);
+		  if (position == steps.size()) {
+			  if (element.empty()) {
+				  self.complete(Code::unknown_webdirver_error, std::nullopt);
+			  } else {
+				  self.complete(ec, Element{ session, element });
+			  }
+			  return;
+		  }
+
+		  const auto& step = steps[position];
+		  if (step.kind == Locator::Step::Kind::frame) {
+			  pending = Pending::frame;
+			  session->_post(session->_prefix + "/frame", nlohmann::json{ { "id", std::move(context) } },
+			                 std::move(self), value);
+			  return;
+		  }
+
+		  // Everything up to the next frame can be resolved by a single script.
+		  segment_end = position;
+		  while (segment_end < steps.size() && steps[segment_end].kind != Locator::Step::Kind::frame) {
+			  ++segment_end;
+		  }
+		  if (!native && segment_end - position > 1) {
+			  pending = Pending::script;
+			  session->_post(session->_prefix + "/execute/sync",
+			                 nlohmann::json{
+			                   { "script", detail::resolve_locator_script },
+			                   { "args", nlohmann::json::array(
+			                               { detail::make_locator_script_steps(steps, position, segment_end),
+			                                 context }) } },
+			                 std::move(self), value, detail::Access::read);
+			  return;
+		  }
+
+		  pending = Pending::native;
+		  native = false;
+		  if (step.kind == Locator::Step::Kind::shadow_root) {
+			  session->_get(make_keys(session->_prefix, "/element/", element, "/shadow"), std::move(self), value);
+			  return;
+		  }
+		  std::string endpoint = session->_prefix;
+		  if (const auto shadow = detail::get_reference_id(context, detail::shadow_root_identifier);
+		      !shadow.empty()) {
+			  endpoint = make_keys(endpoint, "/shadow/", shadow);
+		  } else if (!element.empty()) {
+			  endpoint = make_keys(endpoint, "/element/", element);
+		  }
+		  endpoint += "/element";
+		  session->_post(
+		    endpoint,
+		    nlohmann::json{ { "using", detail::strategy_to_string(step.strategy) }, { "value", step.selector } },
+		    std::move(self), value, detail::Access::read);
+	  },
+	  token, get_executor());
+}
+
+template<typename Token>
+inline auto Session::async_fill_form(std::vector<FormAction> actions, Token&& token)
+{
+	enum class Pending {
+		none,
+		script,
+		native,
+		resolve,
+	};
+
+	for (const auto& action : actions) {
+		detail::check_form_locator(action.locator);
+	}
+
+	using Results = std::vector<curlio::detail::asio_error_code>;
+	return CURLIO_ASIO_NS::async_compose<Token, void(curlio::detail::asio_error_code, Results)>(
+	  [session = shared_from_this(), actions = std::move(actions), results = Results{}, next = std::size_t{ 0 },
+	   chunk_end = std::size_t{ 0 }, natives = std::vector<std::pair<std::size_t, std::string>>{},
+	   native_position = std::size_t{ 0 }, pending = Pending::none](
+	    auto& self, curlio::detail::asio_error_code ec = {}, nlohmann::json result = nullptr) mutable {
+		  if (ec && ec.category() != code_category()) {
+			  self.complete(ec, std::move(results));
+			  return;
+		  }
+
+		  switch (pending) {
+		  case Pending::none: results.resize(actions.size()); break;
+		  case Pending::script:
+			  if (ec || !result.is_array()) {
+				  for (; next < chunk_end; ++next) {
+					  results[next] = ec ? ec : Code::javascript_error;
+				  }
+				  break;
+			  }
+			  for (const auto& item : result) {
+				  if (item.is_object()) {
+					  natives.emplace_back(next, detail::get_reference_id(item, detail::web_element_identifier));
+				  } else if (item == 1) {
+					  results[next] = Code::no_such_element;
+				  } else if (item == 2) {
+					  results[next] = Code::invalid_element_state;
+				  } else if (item == 3) {
+					  // Only native commands can find this element. The locator is copied because `self` owns it.
+					  pending = Pending::resolve;
+					  auto locator = actions[next].locator;
+					  session->async_find_element(
+					    locator,
+					    [self = std::move(self)](curlio::detail::asio_error_code ec,
+					                             std::optional<Element> element) mutable {
+						    self(ec, element ? nlohmann::json(*element) : nlohmann::json{});
+					    });
+					  return;
+				  }
+				  ++next;
+			  }
+			  break;
+		  case Pending::native:
+			  results[natives[native_position].first] = ec;
+			  ++native_position;
+			  break;
+		  case Pending::resolve:
+			  if (ec || result.is_null()) {
+				  results[next] = ec ? ec : Code::no_such_element;
+				  ++next;
+				  break;
+			  }
+			  // Perform the action on the found element with the same script.
+			  pending = Pending::script;
+			  chunk_end = next + 1;
+			  session->_post(
+			    session->_prefix + "/execute/sync",
+			    nlohmann::json{ { "script", detail::fill_form_script },
+			                    { "args", nlohmann::json::array({ nlohmann::json::array({ nlohmann::json::array(
+			                                { nlohmann::json::array(), detail::to_script_kind(actions[next].kind),
+			                                  actions[next].value, std::move(result) }) }) }) } },
+			    std::move(self), [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+				    if (detail::check_error(ec, response)) {
+					    return std::move(response["value"]);
+				    }
+				    return nlohmann::json{};
+			    });
+			  return;
+		  }
+
+		  const auto ignore = [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+			  detail::check_error(ec, response);
+			  return nlohmann::json{};
+		  };
+		  if (native_position < natives.size()) {
+			  const auto& [index, id] = natives[native_position];
+			  const auto prefix = make_keys(session->_prefix, "/element/", id);
+			  pending = Pending::native;
+			  if (actions[index].kind == FormAction::Kind::type) {
+				  session->_post(prefix + "/value", nlohmann::json{ { "text", actions[index].value } },
+				                 std::move(self), ignore);
+			  } else {
+				  session->_post(prefix + "/click", nlohmann::json::object(), std::move(self), ignore);
+			  }
+			  return;
+		  }
+		  natives.clear();
+		  native_position = 0;
+
+		  if (next == actions.size()) {
+			  self.complete(curlio::detail::asio_error_code{}, std::move(results));
+			  return;
+		  }
+
+		  // The scripted actions and the native ones following them up to the first click.
+		  chunk_end = next;
+		  while (chunk_end < actions.size() && !detail::is_native(actions[chunk_end].kind)) {
+			  ++chunk_end;
+		  }
+		  if (chunk_end < actions.size() && actions[chunk_end].kind == FormAction::Kind::click) {
+			  ++chunk_end;
+		  } else {
+			  while (chunk_end < actions.size() && actions[chunk_end].kind == FormAction::Kind::type) {
+				  ++chunk_end;
+			  }
+		  }
+		  auto entries = nlohmann::json::array();
+		  for (auto i = next; i < chunk_end; ++i) {
+			  const auto& steps = actions[i].locator.get_steps();
+			  entries.push_back(nlohmann::json::array({ detail::make_locator_script_steps(steps, 0, steps.size()),
+			                                            detail::to_script_kind(actions[i].kind), actions[i].value,
+			                                            nullptr }));
+		  }
+		  pending = Pending::script;
+		  session->_post(
+		    session->_prefix + "/execute/sync",
+		    nlohmann::json{ { "script", detail::fill_form_script },
+		                    { "args", nlohmann::json::array({ std::move(entries) }) } },
+		    std::move(self), [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+			    if (detail::check_error(ec, response)) {
+				    return std::move(response["value"]);
+			    }
+			    return nlohmann::json{};
+		    });
+	  },
+	  token, get_executor());
+}
+
 template<typename Token>
 inline auto Session::async_execute_script_sync(std::string_view script, Token&& token)
+{
+	return async_execute_script_sync(script, 0, std::forward<Token>(token));
+}
+
+template<typename Token>
+inline auto Session::async_execute_script_sync(std::string_view script, std::size_t max_response_size,
+                                               Token&& token)
 {
 	return _post(
 	  _prefix + "/execute/sync", nlohmann::json{ { "script", script }, { "args", nlohmann::json::array() } },
-	  std::forward<Token>(token), [this](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+	  std::forward<Token>(token),
+	  [this](curlio::detail::asio_error_code& ec, nlohmann::json response) {
 		  return std::move(response["value"]);
-	  });
+	  },
+	  detail::Access::write, max_response_size);
 }
 
 template<typename Token>
 inline auto Session::async_execute_script_async(std::string_view script, nlohmann::json arguments,
                                                 Token&& token)
+{
+	return async_execute_script_async(script, std::move(arguments), 0, std::forward<Token>(token));
+}
+
+template<typename Token>
+inline auto Session::async_execute_script_async(std::string_view script, nlohmann::json arguments,
+                                                std::size_t max_response_size, Token&& token)
 {
 	nlohmann::json::array_t args = nlohmann::json::array();
 
@@ -255,78 +884,788 @@ inline auto Session::async_execute_script_async(std::string_view script, nlohman
 
 	return _post(
 	  _prefix + "/execute/async", nlohmann::json{ { "script", std::move(tmp) }, { "args", std::move(args) } },
-	  std::forward<Token>(token), [this](curlio::detail::asio_error_code& /* ec */, nlohmann::json response) {
+	  std::forward<Token>(token),
+	  [this](curlio::detail::asio_error_code& /* ec */, nlohmann::json response) {
 		  return std::move(response["value"]);
-	  });
+	  },
+	  detail::Access::write, max_response_size);
+}
+
+template<typename Token>
+inline auto Session::async_execute_prepared_script(const PreparedScript& script,
+                                                   nlohmann::json::array_t arguments, Token&& token)
+{
+	return CURLIO_ASIO_NS::async_compose<Token, void(curlio::detail::asio_error_code, nlohmann::json)>(
+	  [session = shared_from_this(), data = script._data, arguments = nlohmann::json(std::move(arguments)),
+	   installing = false](auto& self, curlio::detail::asio_error_code ec = {},
+	                       std::optional<nlohmann::json> envelope = std::nullopt) mutable {
+		  if (ec) {
+			  self.complete(ec, nullptr);
+			  return;
+		  }
+
+		  if (envelope.has_value()) {
+			  if (const auto it = envelope->find("value"); it != envelope->end()) {
+				  session->_installed_scripts.insert(data->id);
+				  self.complete(ec, std::move(*it));
+				  return;
+			  } else if (envelope->contains("failure")) {
+				  // Not `error` which would be taken for an error of the WebDriver.
+				  WDLITE_LOG(log::Level::warning, "prepared script failed", data->id, envelope->at("failure").dump());
+				  self.complete(Code::javascript_error, nullptr);
+				  return;
+			  } else if (installing || !envelope->contains("missing")) {
+				  self.complete(Code::unknown_webdirver_error, nullptr);
+				  return;
+			  }
+			  // The document changed since the last installation.
+			  session->_installed_scripts.erase(data->id);
+		  }
+
+		  installing = !session->_installed_scripts.count(data->id);
+		  session->_post(
+		    session->_prefix + "/execute/async",
+		    nlohmann::json{ { "script", installing ? data->install_and_invoke : data->invoke },
+		                    { "args", nlohmann::json::array({ arguments }) } },
+		    std::move(self),
+		    [](curlio::detail::asio_error_code& ec, nlohmann::json response) -> std::optional<nlohmann::json> {
+			    if (detail::check_error(ec, response) && response["value"].is_object()) {
+				    return std::move(response["value"]);
+			    } else if (!ec) {
+				    ec = Code::unknown_webdirver_error;
+			    }
+			    return std::nullopt;
+		    });
+	  },
+	  token, get_executor());
+}
+
+template<typename Token>
+inline auto Session::async_snapshot_dom(DomSnapshot::Options options, Token&& token) const
+{
+	return _async_snapshot_dom(nullptr, options, std::forward<Token>(token));
+}
+
+template<typename Token>
+inline auto Session::async_snapshot_dom(const Element& root, DomSnapshot::Options options,
+                                        Token&& token) const
+{
+	return _async_snapshot_dom(root, options, std::forward<Token>(token));
+}
+
+template<typename Token>
+inline auto Session::async_execute_cdp(std::string_view command, nlohmann::json parameters, Token&& token)
+{
+	return _post(_prefix + "/goog/cdp/execute",
+	             nlohmann::json{ { "cmd", command }, { "params", std::move(parameters) } },
+	             std::forward<Token>(token), [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+		             if (detail::check_error(ec, response)) {
+			             return std::move(response["value"]);
+		             }
+		             return nlohmann::json{};
+	             });
+}
+
+template<typename Token>
+inline auto Session::async_wait_for_network_idle(std::chrono::steady_clock::duration quiet_period,
+                                                 std::size_t max_in_flight,
+                                                 std::chrono::steady_clock::duration deadline, Token&& token)
+{
+	using std::chrono::duration_cast;
+	using std::chrono::milliseconds;
+
+	auto args = nlohmann::json::array({ duration_cast<milliseconds>(quiet_period).count(), max_in_flight,
+	                                    duration_cast<milliseconds>(deadline).count() });
+	// Only observes the page, so other reads may run while waiting.
+	return _post(
+	  _prefix + "/execute/async",
+	  nlohmann::json{ { "script", detail::network_idle_script }, { "args", std::move(args) } },
+	  std::forward<Token>(token),
+	  [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+		  return detail::check_error(ec, response, nlohmann::json::value_t::boolean) && response["value"] == true;
+	  },
+	  detail::Access::read);
+}
+
+template<typename Token>
+inline auto Session::async_wait_for_render_stable(std::chrono::steady_clock::duration quiet_period,
+                                                  std::chrono::steady_clock::duration deadline, Token&& token)
+{
+	using std::chrono::duration_cast;
+	using std::chrono::milliseconds;
+
+	auto args = nlohmann::json::array(
+	  { duration_cast<milliseconds>(quiet_period).count(), duration_cast<milliseconds>(deadline).count() });
+	// Only observes the page, so other reads may run while waiting.
+	return _post(
+	  _prefix + "/execute/async",
+	  nlohmann::json{ { "script", detail::render_stable_script }, { "args", std::move(args) } },
+	  std::forward<Token>(token),
+	  [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+		  return detail::check_error(ec, response, nlohmann::json::value_t::boolean) && response["value"] == true;
+	  },
+	  detail::Access::read);
+}
+
+template<typename Token>
+inline auto Session::async_navigate_and_extract(std::string url, std::string_view script,
+                                                nlohmann::json::array_t arguments, ExtractOptions options,
+                                                Token&& token)
+{
+	using clock = std::chrono::steady_clock;
+	using std::chrono::duration_cast;
+	using std::chrono::milliseconds;
+
+	auto args = nlohmann::json::array({ std::move(arguments),
+	                                    duration_cast<milliseconds>(options.quiet_period).count(),
+	                                    options.max_in_flight,
+	                                    duration_cast<milliseconds>(options.deadline).count() });
+	nlohmann::json payload{ { "script", detail::make_extract_script(script, options) },
+		                      { "args", std::move(args) } };
+
+	return CURLIO_ASIO_NS::async_compose<Token, void(curlio::detail::asio_error_code, ExtractResult)>(
+	  [session = shared_from_this(), url = std::move(url), payload = std::move(payload), started = clock::now(),
+	   navigated = clock::time_point{}, navigating = false](
+	    auto& self, curlio::detail::asio_error_code ec = {},
+	    std::optional<nlohmann::json> envelope = std::nullopt) mutable {
+		  if (ec) {
+			  self.complete(ec, ExtractResult{});
+			  return;
+		  }
+
+		  if (!envelope.has_value()) {
+			  if (!navigating) {
+				  navigating = true;
+				  session->async_navigate(url, std::move(self));
+				  return;
+			  }
+			  navigated = clock::now();
+			  session->_post(
+			    session->_prefix + "/execute/async", payload, std::move(self),
+			    [](curlio::detail::asio_error_code& ec, nlohmann::json response) -> std::optional<nlohmann::json> {
+				    if (detail::check_error(ec, response) && response["value"].is_object()) {
+					    return std::move(response["value"]);
+				    } else if (!ec) {
+					    ec = Code::unknown_webdirver_error;
+				    }
+				    return std::nullopt;
+			    });
+			  return;
+		  } else if (const auto it = envelope->find("failure"); it != envelope->end()) {
+			  WDLITE_LOG(log::Level::warning, "extraction failed", url, it->dump());
+			  self.complete(Code::javascript_error, ExtractResult{});
+			  return;
+		  }
+
+		  ExtractResult result{};
+		  result.value = std::move((*envelope)["value"]);
+		  result.ready = envelope->value("ready", false);
+		  auto& timings = result.timings;
+		  timings.navigation = navigated - started;
+		  if (const auto& timing = (*envelope)["timing"]; timing.is_array() && timing.size() == 3) {
+			  timings.response_start = detail::from_browser_time(timing[0]);
+			  timings.dom_content_loaded = detail::from_browser_time(timing[1]);
+			  timings.load = detail::from_browser_time(timing[2]);
+		  }
+		  timings.ready_wait = detail::from_browser_time((*envelope)["wait"]);
+		  timings.extraction = detail::from_browser_time((*envelope)["extract"]);
+		  timings.total = clock::now() - started;
+		  self.complete(ec, std::move(result));
+	  },
+	  token, get_executor());
+}
+
+template<typename Token>
+inline auto Session::async_take_full_page_screenshot(std::string path, FullPageScreenshotOptions options,
+                                                     Token&& token)
+{
+	return CURLIO_ASIO_NS::async_compose<Token,
+	                                     void(curlio::detail::asio_error_code, std::vector<ScreenshotTile>)>(
+	  [session = shared_from_this(), path = std::move(path), options,
+	   capture = std::shared_ptr<detail::FullPageCapture>{},
+	   measuring = false](auto& self, curlio::detail::asio_error_code ec = {},
+	                      nlohmann::json metrics = nullptr) mutable {
+		  if (capture != nullptr) {
+			  // All captures finished.
+			  if (capture->error) {
+				  self.complete(capture->error, std::vector<ScreenshotTile>{});
+			  } else {
+				  self.complete(capture->error, std::move(capture->tiles));
+			  }
+			  return;
+		  } else if (ec) {
+			  self.complete(ec, std::vector<ScreenshotTile>{});
+			  return;
+		  } else if (!measuring) {
+			  measuring = true;
+			  session->async_execute_cdp("Page.getLayoutMetrics", nlohmann::json::object(), std::move(self));
+			  return;
+		  }
+
+		  // Older versions only report the size in device pixels.
+		  const auto size =
+		    metrics.contains("cssContentSize") ? metrics["cssContentSize"] : metrics["contentSize"];
+		  if (!size.is_object() || !size["width"].is_number() || !size["height"].is_number()) {
+			  self.complete(Code::unknown_webdirver_error, std::vector<ScreenshotTile>{});
+			  return;
+		  }
+		  const auto width = static_cast<std::uint32_t>(std::ceil(size["width"].get<double>()));
+		  const auto height = std::max(static_cast<std::uint32_t>(std::ceil(size["height"].get<double>())), 1u);
+		  const auto tile_height = options.tile_height == 0 ? height : options.tile_height;
+
+		  capture = std::make_shared<detail::FullPageCapture>(detail::FullPageCapture{
+		    options, {}, 0, 0, {},
+		    CURLIO_ASIO_NS::steady_timer{ session->get_executor(),
+		                                  CURLIO_ASIO_NS::steady_timer::time_point::max() } });
+		  for (std::uint32_t y = 0; y < height; y += tile_height) {
+			  capture->tiles.push_back(ScreenshotTile{ path, 0, y, width, std::min(tile_height, height - y), 0 });
+		  }
+		  if (capture->tiles.size() > 1) {
+			  for (std::size_t i = 0; i < capture->tiles.size(); ++i) {
+				  capture->tiles[i].path = detail::make_tile_path(path, i);
+			  }
+		  }
+		  session->_capture_tiles(capture);
+		  capture->timer.async_wait(std::move(self));
+	  },
+	  token, get_executor());
+}
+
+template<typename Token>
+inline auto Session::async_get_cookies(Token&& token) const
+{
+	return _get(_prefix + "/cookie", std::forward<Token>(token),
+	            [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+		            std::vector<Cookie> cookies{};
+		            if (detail::check_error(ec, response)) {
+			            cookies = response["value"].get<std::vector<Cookie>>();
+		            }
+		            return cookies;
+	            });
+}
+
+template<typename Token>
+inline auto Session::async_get_cookie(std::string_view name, Token&& token) const
+{
+	return _get(make_keys(_prefix, "/cookie/", detail::encode_path_segment(name)), std::forward<Token>(token),
+	            [](curlio::detail::asio_error_code& ec, nlohmann::json response) -> std::optional<Cookie> {
+		            if (detail::check_error(ec, response)) {
+			            return response["value"].get<Cookie>();
+		            } else if (ec == Code::no_such_cookie) {
+			            ec = {};
+		            }
+		            return std::nullopt;
+	            });
+}
+
+template<typename Token>
+inline auto Session::async_add_cookie(const Cookie& cookie, Token&& token)
+{
+	return _post(_prefix + "/cookie", nlohmann::json{ { "cookie", cookie } }, std::forward<Token>(token),
+	             [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+		             detail::check_error(ec, response);
+	             });
+}
+
+template<typename Token>
+inline auto Session::async_delete_cookie(std::string_view name, Token&& token)
+{
+	return _delete(make_keys(_prefix, "/cookie/", detail::encode_path_segment(name)),
+	               std::forward<Token>(token),
+	               [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+		               detail::check_error(ec, response);
+	               });
+}
+
+template<typename Token>
+inline auto Session::async_delete_all_cookies(Token&& token)
+{
+	return _delete(_prefix + "/cookie", std::forward<Token>(token),
+	               [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+		               detail::check_error(ec, response);
+	               });
+}
+
+template<typename Token>
+inline auto Session::async_capture_state(Token&& token)
+{
+	return CURLIO_ASIO_NS::async_compose<Token, void(curlio::detail::asio_error_code, SessionState)>(
+	  [session = shared_from_this(), state = SessionState{}, step = 0](
+	    auto& self, curlio::detail::asio_error_code ec = {}, nlohmann::json result = nullptr) mutable {
+		  if (ec) {
+			  self.complete(ec, SessionState{});
+			  return;
+		  }
+
+		  const auto value = [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+			  if (detail::check_error(ec, response)) {
+				  return std::move(response["value"]);
+			  }
+			  return nlohmann::json{};
+		  };
+		  switch (step++) {
+		  case 0: session->_get(session->_prefix + "/cookie", std::move(self), value); break;
+		  case 1:
+			  state.cookies = result.get<std::vector<Cookie>>();
+			  session->_post(session->_prefix + "/execute/sync",
+			                 nlohmann::json{ { "script", detail::capture_state_script },
+			                                 { "args", nlohmann::json::array() } },
+			                 std::move(self), value);
+			  break;
+		  default: {
+			  auto cookies = std::move(state.cookies);
+			  state = result.get<SessionState>();
+			  state.cookies = std::move(cookies);
+			  self.complete(ec, std::move(state));
+			  break;
+		  }
+		  }
+	  },
+	  token, get_executor());
+}
+
+template<typename Token>
+inline auto Session::async_restore_state(SessionState state, Token&& token)
+{
+	enum class Step {
+		start,
+		register_storage,
+		set_cookies,
+		load,
+		unregister_storage,
+		// The fallback without DevTools.
+		navigate,
+		restore_storage,
+		add_cookies,
+	};
+
+	return CURLIO_ASIO_NS::async_compose<Token, void(curlio::detail::asio_error_code)>(
+	  [session = shared_from_this(), state = std::move(state), step = Step::start, cookie = std::size_t{ 0 },
+	   identifier = std::string{}, error = curlio::detail::asio_error_code{}](
+	    auto& self, curlio::detail::asio_error_code ec = {}, nlohmann::json result = nullptr) mutable {
+		  if (ec == Code::unknown_command && (step == Step::register_storage || step == Step::set_cookies) &&
+		      identifier.empty()) {
+			  ec = {};
+			  step = Step::navigate;
+			  session->async_navigate(state.url, std::move(self));
+			  return;
+		  } else if (ec && step == Step::load) {
+			  // The script must not outlive a failed navigation either.
+			  error = std::exchange(ec, {});
+		  } else if (ec) {
+			  self.complete(ec);
+			  return;
+		  }
+
+		  switch (step) {
+		  case Step::start:
+			  step = Step::register_storage;
+			  if (!state.local_storage.empty() || !state.session_storage.empty()) {
+				  session->async_execute_cdp(
+				    "Page.addScriptToEvaluateOnNewDocument",
+				    nlohmann::json{ { "source", detail::make_restore_storage_script(state) } }, std::move(self));
+				  return;
+			  }
+			  [[fallthrough]];
+		  case Step::register_storage:
+			  step = Step::set_cookies;
+			  if (result.is_object()) {
+				  identifier = result.value("identifier", std::string{});
+			  }
+			  if (!state.cookies.empty()) {
+				  auto cookies = nlohmann::json::array();
+				  for (const auto& cookie : state.cookies) {
+					  cookies.push_back(detail::make_cdp_cookie(cookie, state.url));
+				  }
+				  session->async_execute_cdp("Network.setCookies",
+				                             nlohmann::json{ { "cookies", std::move(cookies) } }, std::move(self));
+				  return;
+			  }
+			  [[fallthrough]];
+		  case Step::set_cookies:
+			  if (identifier.empty()) {
+				  self.complete(ec);
+				  return;
+			  }
+			  // The registered script sets the storage before any script of the page runs.
+			  step = Step::load;
+			  session->async_navigate(state.url, std::move(self));
+			  break;
+		  case Step::load:
+			  // Otherwise every later document of the origin would get the stale storage again.
+			  step = Step::unregister_storage;
+			  session->async_execute_cdp("Page.removeScriptToEvaluateOnNewDocument",
+			                             nlohmann::json{ { "identifier", identifier } }, std::move(self));
+			  break;
+		  case Step::unregister_storage: self.complete(error ? error : ec); break;
+
+		  case Step::navigate:
+			  step = Step::restore_storage;
+			  session->_post(session->_prefix + "/execute/sync",
+			                 nlohmann::json{ { "script", detail::make_restore_storage_script(state) },
+			                                 { "args", nlohmann::json::array() } },
+			                 std::move(self), [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+				                 detail::check_error(ec, response);
+			                 });
+			  break;
+		  case Step::restore_storage:
+		  case Step::add_cookies:
+			  step = Step::add_cookies;
+			  if (cookie < state.cookies.size()) {
+				  session->async_add_cookie(state.cookies[cookie++], std::move(self));
+			  } else {
+				  self.complete(ec);
+			  }
+			  break;
+		  }
+	  },
+	  token, get_executor());
+}
+
+template<typename Token>
+inline auto Session::async_get_window_handle(Token&& token) const
+{
+	return _get(_prefix + "/window", std::forward<Token>(token),
+	            [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+		            if (detail::check_error(ec, response, nlohmann::json::value_t::string) &&
+		                response["value"].is_string()) {
+			            return std::move(response["value"].get_ref<std::string&>());
+		            } else if (!ec) {
+			            ec = Code::unknown_webdirver_error;
+		            }
+		            return std::string{};
+	            });
+}
+
+template<typename Token>
+inline auto Session::async_get_window_handles(Token&& token) const
+{
+	return _get(_prefix + "/window/handles", std::forward<Token>(token),
+	            [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+		            std::vector<std::string> handles{};
+		            if (detail::check_error(ec, response)) {
+			            handles = response["value"].get<std::vector<std::string>>();
+		            }
+		            return handles;
+	            });
+}
+
+template<typename Token>
+inline auto Session::async_new_window(WindowType type, Token&& token)
+{
+	return _post(_prefix + "/window/new",
+	             nlohmann::json{ { "type", type == WindowType::tab ? "tab" : "window" } },
+	             std::forward<Token>(token), [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+		             if (detail::check_error(ec, response)) {
+			             return std::move(response["value"]["handle"].get_ref<std::string&>());
+		             }
+		             return std::string{};
+	             });
+}
+
+template<typename Token>
+inline auto Session::async_switch_to_window(std::string_view handle, Token&& token)
+{
+	// Unknown until the switch succeeded.
+	_window_handle.clear();
+
+	return _post(_prefix + "/window", nlohmann::json{ { "handle", handle } }, std::forward<Token>(token),
+	             [this, handle = std::string{ handle }](curlio::detail::asio_error_code& ec,
+	                                                    nlohmann::json response) mutable {
+		             if (detail::check_error(ec, response)) {
+			             _window_handle = std::move(handle);
+		             }
+	             });
+}
+
+template<typename Token>
+inline auto Session::async_close_window(Token&& token)
+{
+	_window_handle.clear();
+
+	return _delete(_prefix + "/window", std::forward<Token>(token),
+	               [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+		               std::vector<std::string> handles{};
+		               if (detail::check_error(ec, response)) {
+			               handles = response["value"].get<std::vector<std::string>>();
+		               }
+		               return handles;
+	               });
+}
+
+template<typename Token>
+inline auto Session::async_perform_actions(const Actions& actions, Token&& token)
+{
+	return _post(_prefix + "/actions", nlohmann::json{ { "actions", actions } }, std::forward<Token>(token),
+	             [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+		             detail::check_error(ec, response);
+	             });
+}
+
+template<typename Token>
+inline auto Session::async_release_actions(Token&& token)
+{
+	return _delete(_prefix + "/actions", std::forward<Token>(token),
+	               [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+		               detail::check_error(ec, response);
+	               });
 }
 
 template<typename Token, typename Lambda>
-inline auto Session::_get(const std::string& endpoint, Token&& token, Lambda&& lambda) const
+inline auto Session::_get(std::string endpoint, Token&& token, Lambda&& lambda,
+                          std::size_t max_response_size) const
 {
-	return detail::perform_request(_session, _endpoint + endpoint, std::forward<Token>(token),
-	                               std::forward<Lambda>(lambda), [](curlio::Request& /* request */) {});
+	return detail::perform_request(_session, _endpoint, _queue, _counters, detail::Access::read,
+	                               detail::Command{ detail::Method::get, std::move(endpoint), {},
+	                                                _resolve_max_response_size(max_response_size) },
+	                               std::forward<Token>(token), _watch_staleness(std::forward<Lambda>(lambda)));
 }
 
 template<typename Token, typename Lambda>
-inline auto Session::_post(const std::string& endpoint, const nlohmann::json& payload, Token&& token,
-                           Lambda&& lambda) const
+inline auto Session::_post(std::string endpoint, const nlohmann::json& payload, Token&& token,
+                           Lambda&& lambda, detail::Access access, std::size_t max_response_size) const
 {
-	return detail::perform_request(_session, _endpoint + endpoint, std::forward<Token>(token),
-	                               std::forward<Lambda>(lambda),
-	                               [payload = payload.dump()](curlio::Request& request) {
-		                               request.set_option<CURLOPT_COPYPOSTFIELDS>(payload.c_str());
-		                               request.append_header("content-type: application/json");
-		                               WDLITE_DEBUG("Sending: " << payload);
-	                               });
+	if (access == detail::Access::write) {
+		_locator_cache->invalidate();
+	}
+	return detail::perform_request(_session, _endpoint, _queue, _counters, access,
+	                               detail::Command{ detail::Method::post, std::move(endpoint), payload.dump(),
+	                                                _resolve_max_response_size(max_response_size) },
+	                               std::forward<Token>(token), _watch_staleness(std::forward<Lambda>(lambda)));
 }
 
 template<typename Token, typename Lambda>
-inline auto Session::_delete(const std::string& endpoint, Token&& token, Lambda&& lambda)
+inline auto Session::_delete(std::string endpoint, Token&& token, Lambda&& lambda)
+{
+	_locator_cache->invalidate();
+	return detail::perform_request(_session, _endpoint, _queue, _counters, detail::Access::write,
+	                               detail::Command{ detail::Method::delete_, std::move(endpoint), {},
+	                                                _resolve_max_response_size(0) },
+	                               std::forward<Token>(token), _watch_staleness(std::forward<Lambda>(lambda)));
+}
+
+inline std::size_t Session::_resolve_max_response_size(std::size_t max_response_size) const noexcept
+{
+	if (max_response_size == 0) {
+		return _max_response_size;
+	}
+	return max_response_size == SIZE_MAX ? 0 : max_response_size;
+}
+
+template<typename Lambda>
+inline auto Session::_watch_staleness(Lambda&& lambda) const
+{
+	return [cache = _locator_cache, lambda = std::forward<Lambda>(lambda)](
+	         curlio::detail::asio_error_code& ec, nlohmann::json response) mutable {
+		if (cache->is_enabled() && detail::is_stale_element_response(response)) {
+			cache->invalidate();
+		}
+		return lambda(ec, std::move(response));
+	};
+}
+
+inline void Session::_capture_tiles(std::shared_ptr<detail::FullPageCapture> capture) const
 {
-	return detail::perform_request(
-	  _session, _endpoint + endpoint, std::forward<Token>(token), std::forward<Lambda>(lambda),
-	  [](curlio::Request& request) { request.set_option<CURLOPT_CUSTOMREQUEST>("DELETE"); });
+	const auto& options = capture->options;
+	while (!capture->error && capture->next < capture->tiles.size() &&
+	       capture->running < std::max<std::size_t>(options.max_parallel, 1)) {
+		const auto index = capture->next++;
+		const auto& tile = capture->tiles[index];
+		nlohmann::json parameters{
+			{ "format", detail::to_string(options.format) },
+			{ "captureBeyondViewport", true },
+			{ "clip",
+			  { { "x", tile.x },
+			    { "y", tile.y },
+			    { "width", tile.width },
+			    { "height", tile.height },
+			    { "scale", 1 } } },
+		};
+		if (options.format != ImageFormat::png) {
+			parameters["quality"] = std::clamp(options.quality, 0, 100);
+		}
+
+		++capture->running;
+		// Captures do not change the page and may overlap with other reads.
+		_post(
+		  _prefix + "/goog/cdp/execute",
+		  nlohmann::json{ { "cmd", "Page.captureScreenshot" }, { "params", std::move(parameters) } },
+		  [session = shared_from_this(), capture, index](curlio::detail::asio_error_code ec,
+		                                                 std::string data) mutable {
+			  if (ec) {
+				  --capture->running;
+				  if (!capture->error) {
+					  capture->error = ec;
+				  }
+				  session->_capture_tiles(std::move(capture));
+				  return;
+			  }
+			  // The tile still counts as running, so at most `max_parallel` images are held in memory.
+			  auto executor = capture->options.file_executor;
+			  CURLIO_ASIO_NS::post(executor, [session = std::move(session), capture = std::move(capture), index,
+			                                  data = std::move(data)]() mutable {
+				  const auto size = detail::write_base64_file(capture->tiles[index].path, data);
+				  auto executor = session->get_executor();
+				  CURLIO_ASIO_NS::post(executor, [session = std::move(session), capture = std::move(capture), index,
+				                                  size]() mutable {
+					  --capture->running;
+					  if (size == 0 && !capture->error) {
+						  capture->error = std::make_error_code(std::errc::io_error);
+					  }
+					  capture->tiles[index].size = size;
+					  session->_capture_tiles(std::move(capture));
+				  });
+			  });
+		  },
+		  [](curlio::detail::asio_error_code& ec, nlohmann::json response) -> std::string {
+			  if (!detail::check_error(ec, response)) {
+				  return {};
+			  }
+			  auto& data = response["value"]["data"];
+			  if (!data.is_string()) {
+				  ec = Code::unknown_webdirver_error;
+				  return {};
+			  }
+			  return std::move(data.get_ref<std::string&>());
+		  },
+		  detail::Access::read);
+	}
+
+	if (capture->running == 0) {
+		// Unlike cancelling, this also completes a wait which starts after the captures finished.
+		capture->timer.expires_at(CURLIO_ASIO_NS::steady_timer::time_point::min());
+	}
 }
 
 template<typename Token>
-inline auto Session::_async_find_element(const std::string& endpoint, std::string_view selector,
-                                         LocatorStrategy strategy, Token&& token) const
+inline auto Session::_async_snapshot_dom(nlohmann::json root, DomSnapshot::Options options,
+                                         Token&& token) const
 {
 	return _post(
-	  endpoint, nlohmann::json{ { "using", detail::strategy_to_string(strategy) }, { "value", selector } },
+	  _prefix + "/execute/sync",
+	  nlohmann::json{ { "script", detail::snapshot_dom_script },
+	                  { "args", nlohmann::json::array({ std::move(root), options.visibility }) } },
 	  std::forward<Token>(token),
-	  [this](curlio::detail::asio_error_code& ec, nlohmann::json response) -> std::optional<Element> {
-		  if (detail::check_error(ec, response)) {
-			  return Element{ const_cast<Session*>(this)->shared_from_this(),
-				                std::move(response["value"].front().get_ref<std::string&>()) };
-		  } else if (ec == Code::no_such_element) {
-			  ec = {};
+	  [](curlio::detail::asio_error_code& ec, nlohmann::json response) {
+		  DomSnapshot snapshot{};
+		  if (!detail::check_error(ec, response)) {
+			  return snapshot;
 		  }
-		  return std::nullopt;
-	  });
+		  auto& value = response["value"];
+		  if (!value.is_array() || value.size() != 2 || !value[0].is_string() || !value[1].is_string()) {
+			  ec = Code::unknown_webdirver_error;
+			  return snapshot;
+		  }
+		  try {
+			  snapshot = DomSnapshot::decode(std::move(value[0].get_ref<std::string&>()),
+			                                 value[1].get_ref<const std::string&>());
+		  } catch (const std::invalid_argument& e) {
+			  WDLITE_LOG(log::Level::warning, "DOM snapshot failed", std::string_view{}, e.what());
+			  ec = Code::unknown_webdirver_error;
+		  }
+		  return snapshot;
+	  },
+	  detail::Access::read);
+}
+
+template<typename Token>
+inline auto Session::_async_find_element(const std::string& endpoint, std::string_view selector,
+                                         LocatorStrategy strategy, Token&& token) const
+{
+	auto key = _locator_cache->is_enabled() ? detail::make_locator_key(endpoint, strategy, selector)
+	                                        : std::string{};
+	const auto ids = key.empty() ? nullptr : _locator_cache->find(key);
+	return CURLIO_ASIO_NS::async_initiate<Token, void(curlio::detail::asio_error_code, std::optional<Element>)>(
+	  [](auto handler, std::shared_ptr<Session> session, std::string endpoint, nlohmann::json payload,
+	     std::string key, std::optional<std::string> cached) {
+		  // Both paths start a single operation so that every token sees the same initiation.
+		  if (cached.has_value()) {
+			  detail::async_post_completion<void(curlio::detail::asio_error_code, std::optional<Element>)>(
+			    session->get_executor(), std::move(handler), curlio::detail::asio_error_code{},
+			    std::make_optional(Element{ session, std::move(*cached) }));
+			  return;
+		  }
+		  const auto generation = session->_locator_cache->get_generation();
+		  session->_post(
+		    std::move(endpoint), payload, std::move(handler),
+		    [session, key = std::move(key), generation](
+		      curlio::detail::asio_error_code& ec, nlohmann::json response) mutable -> std::optional<Element> {
+			    if (detail::check_error(ec, response)) {
+				    Element element{ session, std::move(response["value"].front().get_ref<std::string&>()) };
+				    if (!key.empty()) {
+					    session->_locator_cache->insert(std::move(key), { element.get_id() }, generation);
+				    }
+				    return element;
+			    } else if (ec == Code::no_such_element) {
+				    ec = {};
+			    }
+			    return std::nullopt;
+		    },
+		    detail::Access::read);
+	  },
+	  token, const_cast<Session*>(this)->shared_from_this(), endpoint,
+	  nlohmann::json{ { "using", detail::strategy_to_string(strategy) }, { "value", selector } },
+	  std::move(key), ids == nullptr ? std::nullopt : std::make_optional(ids->front()));
 }
 
 template<typename Token>
 inline auto Session::_async_find_elements(const std::string& endpoint, std::string_view selector,
                                           LocatorStrategy strategy, Token&& token) const
 {
-	return _post(
-	  endpoint, nlohmann::json{ { "using", detail::strategy_to_string(strategy) }, { "value", selector } },
-	  std::forward<Token>(token), [this](curlio::detail::asio_error_code& ec, nlohmann::json response) {
-		  std::vector<Element> elements{};
-		  if (detail::check_error(ec, response)) {
-			  for (auto& el : response["value"]) {
-				  elements.push_back(Element{ const_cast<Session*>(this)->shared_from_this(),
-				                              std::move(el.front().get_ref<std::string&>()) });
+	auto key = _locator_cache->is_enabled() ? detail::make_locator_key(endpoint, strategy, selector)
+	                                        : std::string{};
+	const auto ids = key.empty() ? nullptr : _locator_cache->find(key);
+	return CURLIO_ASIO_NS::async_initiate<Token, void(curlio::detail::asio_error_code, std::vector<Element>)>(
+	  [](auto handler, std::shared_ptr<Session> session, std::string endpoint, nlohmann::json payload,
+	     std::string key, std::optional<detail::LocatorCache::Ids> cached) {
+		  // Both paths start a single operation so that every token sees the same initiation.
+		  if (cached.has_value()) {
+			  std::vector<Element> elements{};
+			  elements.reserve(cached->size());
+			  for (auto& id : *cached) {
+				  elements.push_back(Element{ session, std::move(id) });
 			  }
+			  detail::async_post_completion<void(curlio::detail::asio_error_code, std::vector<Element>)>(
+			    session->get_executor(), std::move(handler), curlio::detail::asio_error_code{},
+			    std::move(elements));
+			  return;
 		  }
-		  return elements;
-	  });
+		  const auto generation = session->_locator_cache->get_generation();
+		  session->_post(
+		    std::move(endpoint), payload, std::move(handler),
+		    [session, key = std::move(key), generation](curlio::detail::asio_error_code& ec,
+		                                                nlohmann::json response) mutable {
+			    std::vector<Element> elements{};
+			    if (detail::check_error(ec, response)) {
+				    for (auto& el : response["value"]) {
+					    elements.push_back(Element{ session, std::move(el.front().get_ref<std::string&>()) });
+				    }
+				    if (!key.empty() && !elements.empty()) {
+					    detail::LocatorCache::Ids ids{};
+					    ids.reserve(elements.size());
+					    for (const auto& element : elements) {
+						    ids.push_back(element.get_id());
+					    }
+					    session->_locator_cache->insert(std::move(key), std::move(ids), generation);
+				    }
+			    }
+			    return elements;
+		    },
+		    detail::Access::read);
+	  },
+	  token, const_cast<Session*>(this)->shared_from_this(), endpoint,
+	  nlohmann::json{ { "using", detail::strategy_to_string(strategy) }, { "value", selector } },
+	  std::move(key), ids == nullptr ? std::nullopt : std::make_optional(*ids));
 }
 
 // Define this here to be able to call other functions.
 inline Session::~Session()
 {
+	_endpoint->_sessions.fetch_sub(1, std::memory_order_relaxed);
+	if (_ownership != Ownership::owning || _session_id.empty()) {
+		return;
+	}
+
 	// Closing the last window will delete the session. It is safe to call this function in the destructor as
 	// the internal `detail::perform_request()` does not rely on this instance.
 	_delete(_prefix, CURLIO_ASIO_NS::detached,
@@ -334,7 +1673,7 @@ inline Session::~Session()
 }
 
 template<typename Token>
-inline auto async_new_session(Session::executor_type executor, std::string endpoint,
+inline auto async_new_session(Session::executor_type executor, std::shared_ptr<Endpoint> endpoint,
                               nlohmann::json capabilities, Token&& token)
 {
 	std::shared_ptr<Session> session{ new Session{ std::move(executor), std::move(endpoint) } };
@@ -343,13 +1682,133 @@ inline auto async_new_session(Session::executor_type executor, std::string endpo
 	return session->_post("session", nlohmann::json{ { "capabilities", std::move(capabilities) } },
 	                      std::forward<Token>(token),
 	                      [session](curlio::detail::asio_error_code& ec, nlohmann::json response) mutable {
-		                      if (!ec) {
-			                      // TODO add checks
-			                      session->_session_id = response["value"]["sessionId"].get<std::string>();
+		                      if (detail::check_error(ec, response)) {
+			                      session->_session_id = detail::get_reference_id(response["value"], "sessionId");
+			                      if (session->_session_id.empty()) {
+				                      ec = Code::unknown_webdirver_error;
+			                      }
 			                      session->_prefix = "session/" + session->_session_id;
 		                      }
 		                      return ec ? nullptr : std::move(session);
 	                      });
 }
 
+template<typename Token>
+inline auto async_new_session(Session::executor_type executor, std::string endpoint,
+                              nlohmann::json capabilities, Token&& token)
+{
+	return async_new_session(std::move(executor), std::make_shared<Endpoint>(std::move(endpoint)),
+	                         std::move(capabilities), std::forward<Token>(token));
+}
+
+template<typename Token>
+inline auto async_attach_session(Session::executor_type executor, std::shared_ptr<Endpoint> endpoint,
+                                 std::string session_id, Ownership ownership, Token&& token)
+{
+	std::shared_ptr<Session> session{ new Session{ std::move(executor), std::move(endpoint) } };
+	session->_session_id = std::move(session_id);
+	session->_prefix = "session/" + session->_session_id;
+	// A session which could not be validated must not be deleted.
+	session->_ownership = Ownership::borrowed;
+
+	// The current window handle validates the session and is useful for window switching.
+	return session->_get(session->_prefix + "/window", std::forward<Token>(token),
+	                     [session, ownership](curlio::detail::asio_error_code& ec,
+	                                          nlohmann::json response) mutable -> std::shared_ptr<Session> {
+		                     if (detail::check_error(ec, response, nlohmann::json::value_t::string) &&
+		                         response["value"].is_string()) {
+			                     session->_window_handle = response["value"].get<std::string>();
+		                     } else if (ec == Code::no_such_window) {
+			                     // The session is valid but its current window was closed.
+			                     ec = {};
+		                     }
+		                     if (ec) {
+			                     return nullptr;
+		                     }
+		                     session->_ownership = ownership;
+		                     return std::move(session);
+	                     });
+}
+
+template<typename Token>
+inline auto async_attach_session(Session::executor_type executor, std::string endpoint,
+                                 std::string session_id, Ownership ownership, Token&& token)
+{
+	return async_attach_session(std::move(executor), std::make_shared<Endpoint>(std::move(endpoint)),
+	                            std::move(session_id), ownership, std::forward<Token>(token));
+}
+
+namespace detail {
+
+inline void close_sessions(std::shared_ptr<CloseAll> state)
+{
+	while (!state->completed && state->next < state->sessions.size() &&
+	       state->running < std::max<std::size_t>(state->max_parallel, 1)) {
+		const auto index = state->next++;
+		++state->running;
+		state->sessions[index]->async_close(CURLIO_ASIO_NS::bind_executor(
+		  state->timer.get_executor(), [state, index](curlio::detail::asio_error_code ec) {
+			  --state->running;
+			  if (state->completed) {
+				  return;
+			  }
+			  state->finished[index] = true;
+			  if (ec) {
+				  state->report.failed.emplace_back(state->sessions[index]->get_id(), ec);
+			  } else {
+				  ++state->report.closed;
+			  }
+			  close_sessions(state);
+		  }));
+	}
+
+	if (!state->completed && state->running == 0 && state->next == state->sessions.size()) {
+		state->timer.expires_at(CURLIO_ASIO_NS::steady_timer::time_point::min());
+	}
+}
+
+} // namespace detail
+
+template<typename Token>
+inline auto async_close_all(Session::executor_type executor, std::vector<std::shared_ptr<Session>> sessions,
+                            CloseAllOptions options, Token&& token)
+{
+	auto state = std::make_shared<detail::CloseAll>(detail::CloseAll{
+	  std::move(sessions), options.max_parallel, 0, 0, {}, false, {},
+	  CURLIO_ASIO_NS::steady_timer{ CURLIO_ASIO_NS::make_strand(executor),
+	                                std::chrono::steady_clock::now() + options.deadline } });
+	state->finished.resize(state->sessions.size());
+
+	enum class Step {
+		start,
+		deadline,
+		done,
+	};
+	return CURLIO_ASIO_NS::async_compose<Token, void(curlio::detail::asio_error_code, CloseReport)>(
+	  [state = std::move(state), step = Step::start](auto& self,
+	                                                 curlio::detail::asio_error_code /* ec */ = {}) mutable {
+		  switch (step) {
+		  case Step::start:
+			  step = Step::deadline;
+			  CURLIO_ASIO_NS::dispatch(state->timer.get_executor(), [state] { detail::close_sessions(state); });
+			  state->timer.async_wait(CURLIO_ASIO_NS::bind_executor(state->timer.get_executor(), std::move(self)));
+			  break;
+		  case Step::deadline:
+			  // Either everything finished or the deadline passed. Late results are ignored from now on.
+			  step = Step::done;
+			  state->completed = true;
+			  for (std::size_t i = 0; i < state->sessions.size(); ++i) {
+				  if (!state->finished[i]) {
+					  state->report.stragglers.push_back(state->sessions[i]->get_id());
+				  }
+			  }
+			  // Back to the executor of the handler.
+			  CURLIO_ASIO_NS::post(std::move(self));
+			  break;
+		  case Step::done: self.complete(curlio::detail::asio_error_code{}, std::move(state->report)); break;
+		  }
+	  },
+	  token, std::move(executor));
+}
+
 } // namespace wdlite
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "cookie.hpp"
+
+#include <cstdint>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+namespace wdlite {
+
+/// The state of a logged in browser session which can be restored into another session. See
+/// `Session::async_capture_state()` and `Session::async_restore_state()`.
+struct SessionState {
+	/// The URL of the page the state was captured on.
+	std::string url;
+	/// The origin of `url`. The storage is restored for this origin only.
+	std::string origin;
+	std::vector<Cookie> cookies;
+	std::map<std::string, std::string> local_storage;
+	std::map<std::string, std::string> session_storage;
+};
+
+inline void to_json(nlohmann::json& json, const SessionState& value)
+{
+	json = nlohmann::json{
+		{ "url", value.url },
+		{ "origin", value.origin },
+		{ "cookies", value.cookies },
+		{ "local", value.local_storage },
+		{ "session", value.session_storage },
+	};
+}
+
+inline void from_json(const nlohmann::json& json, SessionState& value)
+{
+	value.url = json.value("url", "");
+	value.origin = json.value("origin", "");
+	value.cookies = json.value("cookies", std::vector<Cookie>{});
+	value.local_storage = json.value("local", std::map<std::string, std::string>{});
+	value.session_storage = json.value("session", std::map<std::string, std::string>{});
+}
+
+/// Serializes the state into a compact binary blob (CBOR).
+inline std::vector<std::uint8_t> serialize_state(const SessionState& state)
+{
+	return nlohmann::json::to_cbor(nlohmann::json(state));
+}
+
+/// Deserializes the state from a blob created by `serialize_state()`. Throws if the blob is malformed.
+inline SessionState deserialize_state(const std::vector<std::uint8_t>& blob)
+{
+	return nlohmann::json::from_cbor(blob).get<SessionState>();
+}
+
+} // namespace wdlite
@@ -0,0 +1,380 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_WIN32)
+#	include <fstream>
+#	include <iterator>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+namespace wdlite {
+
+namespace detail {
+
+enum class Method : std::uint8_t {
+	get,
+	post,
+	delete_,
+};
+
+/// A single WebDriver command as it is sent over the wire.
+struct Command {
+	Method method = Method::get;
+	/// The path relative to the endpoint URL, e.g. `session/<id>/title`.
+	std::string path;
+	/// The JSON body of POST requests.
+	std::string payload;
+	/// Not sent. The response is rejected once its body grows beyond this size. `0` means no limit.
+	std::size_t max_response_size = 0;
+};
+
+/**
+ * The tape file starts with `tape_magic` followed by the exchanges. Every exchange is stored as method
+ * (1 byte), latency in microseconds (4 bytes), path size, request size and response size (4 bytes each),
+ * followed by the three strings. Integers are in host byte order.
+ */
+constexpr std::string_view tape_magic = "WDLTAPE1";
+constexpr std::size_t tape_exchange_header_size = 1 + 4 * 4;
+
+/**
+ * Replaces the IDs of sessions, elements, shadow roots and frames in the path with `*`. The fixed segments
+ * `element/active` and `frame/parent` are kept.
+ */
+inline std::string make_path_template(std::string_view path)
+{
+	std::string result;
+	result.reserve(path.size());
+	std::string_view previous;
+	while (!path.empty()) {
+		const auto end = path.find('/');
+		const auto segment = path.substr(0, end);
+		if (!result.empty()) {
+			result += '/';
+		}
+		const auto literal =
+		  (previous == "element" && segment == "active") || (previous == "frame" && segment == "parent");
+		if (!literal &&
+		    (previous == "session" || previous == "element" || previous == "shadow" || previous == "frame")) {
+			result += '*';
+		} else {
+			result += segment;
+		}
+		previous = segment;
+		path = end == std::string_view::npos ? std::string_view{} : path.substr(end + 1);
+	}
+	return result;
+}
+
+/// Replaces the element and shadow root references in the payload with `*`.
+inline std::string make_payload_template(std::string_view payload)
+{
+	if (payload.empty()) {
+		return {};
+	}
+	auto json = nlohmann::json::parse(payload, nullptr, false);
+	if (json.is_discarded()) {
+		return std::string{ payload };
+	}
+
+	const auto normalize = [](auto& self, nlohmann::json& value) -> void {
+		if (value.is_object()) {
+			for (auto& [key, child] : value.items()) {
+				if (key == "element-6066-11e4-a52e-4f735466cecf" || key == "shadow-6066-11e4-a52e-4f735466cecf") {
+					child = "*";
+				} else {
+					self(self, child);
+				}
+			}
+		} else if (value.is_array()) {
+			for (auto& child : value) {
+				self(self, child);
+			}
+		}
+	};
+	normalize(normalize, json);
+	return json.dump();
+}
+
+inline std::string make_tape_key(Method method, std::string_view path, std::string_view payload)
+{
+	auto key = make_path_template(path);
+	key.insert(key.begin(), static_cast<char>('0' + static_cast<int>(method)));
+	key += '\n';
+	key += make_payload_template(payload);
+	return key;
+}
+
+} // namespace detail
+
+/**
+ * Appends every WebDriver exchange to a tape file which can be replayed with `Replayer`. Attach it to an
+ * endpoint with `Endpoint::set_recorder()`. Recording an existing file appends to it.
+ */
+class Recorder {
+public:
+	using duration = std::chrono::steady_clock::duration;
+
+	explicit Recorder(const std::string& path)
+	{
+		_file = std::fopen(path.c_str(), "ab");
+		if (_file == nullptr) {
+			throw std::runtime_error{ "failed to open tape file " + path };
+		}
+		std::fseek(_file, 0, SEEK_END);
+		if (std::ftell(_file) == 0) {
+			std::fwrite(detail::tape_magic.data(), 1, detail::tape_magic.size(), _file);
+		}
+	}
+	Recorder(const Recorder& copy) = delete;
+	~Recorder() { std::fclose(_file); }
+
+	/// Appends the exchange. Thread-safe.
+	void record(const detail::Command& command, std::string_view response, duration latency)
+	{
+		const auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+		const std::uint32_t sizes[] = {
+			static_cast<std::uint32_t>(std::clamp<std::int64_t>(microseconds, 0, UINT32_MAX)),
+			static_cast<std::uint32_t>(command.path.size()),
+			static_cast<std::uint32_t>(command.payload.size()),
+			static_cast<std::uint32_t>(response.size()),
+		};
+
+		std::lock_guard<std::mutex> lock{ _mutex };
+		std::fputc(static_cast<int>(command.method), _file);
+		std::fwrite(sizes, sizeof(std::uint32_t), 4, _file);
+		std::fwrite(command.path.data(), 1, command.path.size(), _file);
+		std::fwrite(command.payload.data(), 1, command.payload.size(), _file);
+		std::fwrite(response.data(), 1, response.size(), _file);
+		++_count;
+	}
+	/**
+	 * Appends a hand-written exchange, e.g. to mock a WebDriver in tests. Thread-safe.
+	 *
+	 * @param method One of `GET`, `POST` and `DELETE`.
+	 * @param path The path relative to the endpoint URL, e.g. `session/<id>/title`.
+	 * @param payload The JSON body of POST requests as it is sent, i.e. as dumped by `nlohmann::json`.
+	 */
+	void record(std::string_view method, std::string path, std::string payload, std::string_view response,
+	            duration latency = {})
+	{
+		detail::Command command{ detail::Method::get, std::move(path), std::move(payload) };
+		if (method == "POST") {
+			command.method = detail::Method::post;
+		} else if (method == "DELETE") {
+			command.method = detail::Method::delete_;
+		} else if (method != "GET") {
+			throw std::invalid_argument{ "unknown method " + std::string{ method } };
+		}
+		record(command, response, latency);
+	}
+	/// Writes the buffered exchanges to the file.
+	void flush()
+	{
+		std::lock_guard<std::mutex> lock{ _mutex };
+		std::fflush(_file);
+	}
+	/// The number of exchanges recorded by this instance.
+	std::size_t get_count() const
+	{
+		std::lock_guard<std::mutex> lock{ _mutex };
+		return _count;
+	}
+
+	Recorder& operator=(const Recorder& copy) = delete;
+
+private:
+	std::FILE* _file;
+	mutable std::mutex _mutex;
+	std::size_t _count = 0;
+};
+
+/**
+ * Answers WebDriver commands from a tape written by `Recorder` instead of sending them. Attach it to an
+ * endpoint with `Endpoint::set_replayer()`. The file is memory mapped and must not be modified while
+ * replaying.
+ *
+ * Commands are matched by method, path and payload where session, element, shadow root and frame IDs are
+ * ignored. Commands with the same key are answered in the recorded order; the last response is repeated once
+ * the recorded ones are exhausted. A command without any recording fails with `Code::no_recorded_response`.
+ */
+class Replayer {
+public:
+	using duration = std::chrono::steady_clock::duration;
+
+	struct Exchange {
+		detail::Method method;
+		std::string_view path;
+		std::string_view payload;
+		std::string_view response;
+		std::chrono::microseconds latency;
+	};
+
+	/**
+	 * @param path The tape file.
+	 * @param time_scale The recorded latency is multiplied with this factor. `1` replays with the original
+	 * timing while `0` answers as fast as possible.
+	 */
+	explicit Replayer(const std::string& path, double time_scale = 1)
+	{
+		_map(path);
+		set_time_scale(time_scale);
+		try {
+			_index_tape(path);
+		} catch (...) {
+			_unmap();
+			throw;
+		}
+	}
+	Replayer(const Replayer& copy) = delete;
+	~Replayer() { _unmap(); }
+
+	void set_time_scale(double time_scale) noexcept { _time_scale = time_scale < 0 ? 0 : time_scale; }
+	double get_time_scale() const noexcept { return _time_scale; }
+	/// The number of exchanges on the tape.
+	std::size_t size() const noexcept { return _exchanges.size(); }
+	/// The number of commands which could not be answered.
+	std::size_t get_miss_count() const
+	{
+		std::lock_guard<std::mutex> lock{ _mutex };
+		return _misses;
+	}
+	/// Answers the next command with the same key again from the beginning of the tape.
+	void rewind()
+	{
+		std::lock_guard<std::mutex> lock{ _mutex };
+		for (auto& [_, entry] : _index) {
+			entry.next = 0;
+		}
+	}
+
+	/// Finds the recorded exchange for the command. Thread-safe.
+	const Exchange* find(const detail::Command& command)
+	{
+		const auto key = detail::make_tape_key(command.method, command.path, command.payload);
+		std::lock_guard<std::mutex> lock{ _mutex };
+		const auto it = _index.find(key);
+		if (it == _index.end()) {
+			++_misses;
+			return nullptr;
+		}
+		auto& entry = it->second;
+		const auto index = entry.exchanges[std::min(entry.next, entry.exchanges.size() - 1)];
+		if (entry.next < entry.exchanges.size()) {
+			++entry.next;
+		}
+		return &_exchanges[index];
+	}
+	/// How long the answer of the exchange is delayed.
+	duration get_delay(const Exchange& exchange) const noexcept
+	{
+		return std::chrono::duration_cast<duration>(
+		  std::chrono::duration<double, std::micro>{ exchange.latency.count() * _time_scale });
+	}
+
+	Replayer& operator=(const Replayer& copy) = delete;
+
+private:
+	struct Entry {
+		std::vector<std::size_t> exchanges;
+		std::size_t next = 0;
+	};
+
+	const char* _data = nullptr;
+	std::size_t _size = 0;
+	void* _mapping = nullptr;
+	/// Used instead of the mapping if memory mapping is not available.
+	std::string _buffer;
+	std::vector<Exchange> _exchanges;
+	std::unordered_map<std::string, Entry> _index;
+	double _time_scale = 1;
+	mutable std::mutex _mutex;
+	std::size_t _misses = 0;
+
+	void _map(const std::string& path)
+	{
+#if defined(_WIN32)
+		std::ifstream file{ path, std::ios::binary };
+		if (!file) {
+			throw std::runtime_error{ "failed to open tape file " + path };
+		}
+		_buffer.assign(std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{});
+		_data = _buffer.data();
+		_size = _buffer.size();
+#else
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error{ "failed to open tape file " + path };
+		}
+		struct stat status {};
+		if (::fstat(fd, &status) != 0) {
+			::close(fd);
+			throw std::runtime_error{ "failed to open tape file " + path };
+		}
+		_size = static_cast<std::size_t>(status.st_size);
+		if (_size > 0) {
+			_mapping = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+		}
+		::close(fd);
+		if (_mapping == MAP_FAILED) {
+			_mapping = nullptr;
+			throw std::runtime_error{ "failed to map tape file " + path };
+		}
+		_data = static_cast<const char*>(_mapping);
+#endif
+	}
+	void _index_tape(const std::string& path)
+	{
+		std::string_view tape{ _data, _size };
+		if (tape.substr(0, detail::tape_magic.size()) != detail::tape_magic) {
+			throw std::runtime_error{ "invalid tape file " + path };
+		}
+		tape.remove_prefix(detail::tape_magic.size());
+		while (!tape.empty()) {
+			if (tape.size() < detail::tape_exchange_header_size) {
+				throw std::runtime_error{ "truncated tape file " + path };
+			}
+			std::uint32_t sizes[4];
+			std::memcpy(sizes, tape.data() + 1, sizeof(sizes));
+			const auto method = static_cast<detail::Method>(tape.front());
+			tape.remove_prefix(detail::tape_exchange_header_size);
+			if (tape.size() < std::size_t{ sizes[1] } + sizes[2] + sizes[3]) {
+				throw std::runtime_error{ "truncated tape file " + path };
+			}
+
+			Exchange exchange{ method, tape.substr(0, sizes[1]), tape.substr(sizes[1], sizes[2]),
+				                 tape.substr(sizes[1] + sizes[2], sizes[3]), std::chrono::microseconds{ sizes[0] } };
+			tape.remove_prefix(std::size_t{ sizes[1] } + sizes[2] + sizes[3]);
+			_index[detail::make_tape_key(method, exchange.path, exchange.payload)].exchanges.push_back(
+			  _exchanges.size());
+			_exchanges.push_back(exchange);
+		}
+	}
+	void _unmap() noexcept
+	{
+#if !defined(_WIN32)
+		if (_mapping != nullptr) {
+			::munmap(_mapping, _size);
+			_mapping = nullptr;
+		}
+#endif
+	}
+};
+
+} // namespace wdlite
@@ -0,0 +1,6 @@
+// The translation unit of the wdlite library built with `WDLITE_SEPARATE_COMPILATION`.
+#if !defined(WDLITE_SEPARATE_COMPILATION)
+#	error "wdlite.cpp is only compiled with WDLITE_SEPARATE_COMPILATION, otherwise wdlite is header-only."
+#endif
+
+#include "request.ipp"
@@ -1,4 +1,15 @@
+#include "actions.hpp"
 #include "capabilties/capabilities.hpp"
+#include "capabilties/presets.hpp"
+#include "dom.inl"
 #include "element.inl"
+#include "endpoint.hpp"
+#include "extract.hpp"
+#include "form.hpp"
 #include "keys.hpp"
+#include "locator.hpp"
+#include "pool.inl"
+#include "script.hpp"
 #include "session.inl"
+#include "tape.hpp"
+#include "window.inl"
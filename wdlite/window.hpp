@@ -0,0 +1,115 @@
+#pragma once
+
+#include "session.hpp"
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+
+namespace wdlite {
+
+/**
+ * Runs several logical jobs on one browser where every job owns a window. Only one window can be current at a
+ * time, so a job has to acquire a lease for its window before issuing commands. The multiplexer switches the
+ * window if necessary and prefers waiting jobs of the current window to minimize the number of switches.
+ *
+ * ```cpp
+ * const auto multiplexer = std::make_shared<wdlite::WindowMultiplexer>(session);
+ * const auto window = co_await multiplexer->async_open_window(asio::use_awaitable);
+ * {
+ *   const auto lease = co_await multiplexer->async_acquire(window, asio::use_awaitable);
+ *   co_await session->async_navigate("https://example.com", asio::use_awaitable);
+ * }
+ * ```
+ *
+ * All window changes of the session must go through the multiplexer.
+ */
+class WindowMultiplexer : public std::enable_shared_from_this<WindowMultiplexer> {
+public:
+	/// Exclusive access to the session while its window is current. The lease is returned on destruction.
+	class Lease {
+	public:
+		Lease() noexcept = default;
+		Lease(Lease&& move) noexcept;
+		Lease(const Lease& copy) = delete;
+		~Lease();
+
+		/// The handle of the window which is current while this lease is held.
+		const std::string& get_handle() const noexcept;
+		/// Returns the lease early. Afterwards this object is empty.
+		void release() noexcept;
+		explicit operator bool() const noexcept;
+
+		Lease& operator=(Lease&& move) noexcept;
+		Lease& operator=(const Lease& copy) = delete;
+
+	private:
+		friend WindowMultiplexer;
+
+		std::shared_ptr<WindowMultiplexer> _multiplexer;
+		std::string _handle;
+
+		Lease(std::shared_ptr<WindowMultiplexer> multiplexer, std::string handle) noexcept;
+	};
+
+	/**
+	 * @param session The session whose windows are multiplexed.
+	 * @param max_batch The number of leases granted in a row for the current window while jobs of other windows
+	 * are waiting.
+	 */
+	explicit WindowMultiplexer(std::shared_ptr<Session> session, std::size_t max_batch = 8);
+
+	const std::shared_ptr<Session>& get_session() const noexcept;
+	/// The number of window switches performed so far.
+	std::size_t get_switch_count() const noexcept;
+	/// The number of jobs waiting for a lease.
+	std::size_t get_waiting_count() const noexcept;
+
+	/**
+	 * Opens a new tab for a job. The current window is not changed, so no lease is required.
+	 *
+	 * @param token The ASIO completion token.
+	 * @return The handle of the new window stored in a `std::string` depending on `token`.
+	 */
+	template<typename Token>
+	auto async_open_window(Token&& token);
+	/**
+	 * Waits until the session is available and makes the window current.
+	 *
+	 * @param handle The window handle.
+	 * @param token The ASIO completion token.
+	 * @return The `Lease` depending on `token`.
+	 */
+	template<typename Token>
+	auto async_acquire(std::string handle, Token&& token);
+	/**
+	 * Closes the window of the lease and returns it.
+	 *
+	 * @param lease The lease of the window to close.
+	 * @param token The ASIO completion token.
+	 */
+	template<typename Token>
+	auto async_close_window(Lease lease, Token&& token);
+
+private:
+	struct Waiter {
+		std::string handle;
+		CURLIO_ASIO_NS::steady_timer timer;
+		bool granted = false;
+	};
+
+	std::shared_ptr<Session> _session;
+	std::size_t _max_batch;
+	/// Whether a lease is currently held.
+	bool _locked = false;
+	/// The number of leases granted in a row for the current window.
+	std::size_t _batch = 0;
+	std::size_t _switches = 0;
+	std::list<std::shared_ptr<Waiter>> _waiters;
+
+	/// Hands the session to the next waiter.
+	void _release() noexcept;
+};
+
+} // namespace wdlite
@@ -0,0 +1,154 @@
+#include "window.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+namespace wdlite {
+
+inline WindowMultiplexer::Lease::Lease(Lease&& move) noexcept
+    : _multiplexer{ std::move(move._multiplexer) }, _handle{ std::move(move._handle) }
+{}
+
+inline WindowMultiplexer::Lease::~Lease() { release(); }
+
+inline const std::string& WindowMultiplexer::Lease::get_handle() const noexcept { return _handle; }
+
+inline void WindowMultiplexer::Lease::release() noexcept
+{
+	if (const auto multiplexer = std::move(_multiplexer)) {
+		multiplexer->_release();
+	}
+}
+
+inline WindowMultiplexer::Lease::operator bool() const noexcept { return _multiplexer != nullptr; }
+
+inline WindowMultiplexer::Lease& WindowMultiplexer::Lease::operator=(Lease&& move) noexcept
+{
+	if (this != &move) {
+		release();
+		_multiplexer = std::move(move._multiplexer);
+		_handle = std::move(move._handle);
+	}
+	return *this;
+}
+
+inline WindowMultiplexer::Lease::Lease(std::shared_ptr<WindowMultiplexer> multiplexer,
+                                      std::string handle) noexcept
+    : _multiplexer{ std::move(multiplexer) }, _handle{ std::move(handle) }
+{}
+
+inline WindowMultiplexer::WindowMultiplexer(std::shared_ptr<Session> session, std::size_t max_batch)
+    : _session{ std::move(session) }, _max_batch{ std::max<std::size_t>(max_batch, 1) }
+{}
+
+inline const std::shared_ptr<Session>& WindowMultiplexer::get_session() const noexcept { return _session; }
+
+inline std::size_t WindowMultiplexer::get_switch_count() const noexcept { return _switches; }
+
+inline std::size_t WindowMultiplexer::get_waiting_count() const noexcept { return _waiters.size(); }
+
+template<typename Token>
+inline auto WindowMultiplexer::async_open_window(Token&& token)
+{
+	return _session->async_new_window(WindowType::tab, std::forward<Token>(token));
+}
+
+template<typename Token>
+inline auto WindowMultiplexer::async_acquire(std::string handle, Token&& token)
+{
+	return CURLIO_ASIO_NS::async_compose<Token, void(curlio::detail::asio_error_code, Lease)>(
+	  [this, multiplexer = shared_from_this(), handle = std::move(handle), waiter = std::shared_ptr<Waiter>{},
+	   switching = false](auto& self, const auto&... error) mutable {
+		  curlio::detail::asio_error_code ec{};
+		  if constexpr ((std::is_convertible_v<decltype(error), curlio::detail::asio_error_code> && ...)) {
+			  ((ec = error), ...);
+		  }
+
+		  if (switching) {
+			  // The window switch finished.
+			  if (ec) {
+				  _release();
+				  self.complete(ec, Lease{});
+			  } else {
+				  self.complete(ec, Lease{ std::move(multiplexer), std::move(handle) });
+			  }
+			  return;
+		  } else if (waiter == nullptr) {
+			  // Initiation.
+			  if (_locked || !_waiters.empty()) {
+				  waiter = std::make_shared<Waiter>(Waiter{
+				    handle, CURLIO_ASIO_NS::steady_timer{ _session->get_executor(),
+				                                          CURLIO_ASIO_NS::steady_timer::time_point::max() } });
+				  _waiters.push_back(waiter);
+				  waiter->timer.async_wait(std::move(self));
+				  return;
+			  }
+			  _locked = true;
+			  _batch = handle == _session->_window_handle ? _batch + 1 : 1;
+		  } else if (!waiter->granted) {
+			  // The wait was cancelled from the outside.
+			  _waiters.remove(waiter);
+			  self.complete(ec, Lease{});
+			  return;
+		  }
+
+		  if (handle == _session->_window_handle) {
+			  self.complete(ec, Lease{ std::move(multiplexer), std::move(handle) });
+		  } else {
+			  switching = true;
+			  ++_switches;
+			  _session->async_switch_to_window(handle, std::move(self));
+		  }
+	  },
+	  token, _session->get_executor());
+}
+
+template<typename Token>
+inline auto WindowMultiplexer::async_close_window(Lease lease, Token&& token)
+{
+	if (lease._multiplexer.get() != this) {
+		throw std::invalid_argument{ "lease does not belong to this multiplexer" };
+	}
+
+	return CURLIO_ASIO_NS::async_compose<Token, void(curlio::detail::asio_error_code)>(
+	  [this, lease = std::move(lease), started = false](
+	    auto& self, curlio::detail::asio_error_code ec = {},
+	    std::vector<std::string> /* remaining */ = {}) mutable {
+		  if (!started) {
+			  started = true;
+			  _session->async_close_window(std::move(self));
+			  return;
+		  }
+		  lease.release();
+		  self.complete(ec);
+	  },
+	  token, _session->get_executor());
+}
+
+inline void WindowMultiplexer::_release() noexcept
+{
+	_locked = false;
+	if (_waiters.empty()) {
+		return;
+	}
+
+	// Prefer jobs of the current window unless the batch is exhausted.
+	auto it = _waiters.end();
+	if (_batch < _max_batch && !_session->_window_handle.empty()) {
+		it = std::find_if(_waiters.begin(), _waiters.end(),
+		                  [this](const auto& waiter) { return waiter->handle == _session->_window_handle; });
+	}
+	if (it == _waiters.end()) {
+		it = _waiters.begin();
+	}
+
+	const auto waiter = std::move(*it);
+	_waiters.erase(it);
+	_locked = true;
+	_batch = waiter->handle == _session->_window_handle ? _batch + 1 : 1;
+	waiter->granted = true;
+	waiter->timer.cancel();
+}
+
+} // namespace wdlite